@@ -0,0 +1,110 @@
+// Time of the generated hash and equality of a hash map key against a hand
+// written member by member hash, hashing alone and in an unordered_set
+//
+// usage: compare_bench [keys] [iterations]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <random>
+#include <unordered_set>
+#include <vector>
+
+#include <compare_bench_struct.hpp>
+
+namespace naive {
+struct hash {
+  template <class T>
+  static void combine(std::size_t& seed, T const& v) {
+    seed ^= std::hash<T>{}(v) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+  }
+
+  std::size_t operator()(PositionKey const& k) const {
+    std::size_t seed = 0;
+    combine(seed, k.instrument);
+    combine(seed, k.account);
+    combine(seed, k.venue);
+    combine(seed, k.book);
+    combine(seed, k.strategy);
+    combine(seed, k.desk);
+    combine(seed, k.region);
+    combine(seed, k.currency);
+    combine(seed, k.session);
+    combine(seed, k.trader);
+    combine(seed, k.symbol);
+    return seed;
+  }
+};
+}  // namespace naive
+
+template <class F>
+double time_ms(F&& f) {
+  auto start = std::chrono::steady_clock::now();
+  f();
+  std::chrono::duration<double, std::milli> time =
+      std::chrono::steady_clock::now() - start;
+  return time.count();
+}
+
+template <class Hash>
+void run(char const* name, std::vector<PositionKey> const& keys,
+         std::vector<PositionKey> const& lookups, int iterations) {
+  Hash hash;
+  std::size_t sum = 0;
+  auto hash_ms = time_ms([&] {
+    for (int it = 0; it < iterations; ++it) {
+      for (auto& k : keys) {
+        sum += hash(k);
+      }
+    }
+  });
+
+  std::size_t found = 0;
+  auto set_ms = time_ms([&] {
+    std::unordered_set<PositionKey, Hash> set;
+    set.reserve(keys.size());
+    for (auto& k : keys) {
+      set.insert(k);
+    }
+    for (int it = 0; it < iterations; ++it) {
+      for (auto& k : lookups) {
+        found += set.count(k);
+      }
+    }
+  });
+
+  std::cout << name << ": hash " << hash_ms << " ms, unordered_set " << set_ms
+            << " ms (" << (sum & 1) << ' ' << found << ")\n";
+}
+
+int main(int argc, char* argv[]) {
+  std::size_t count = argc > 1 ? std::atoll(argv[1]) : 200'000;
+  int iterations = argc > 2 ? std::atoi(argv[2]) : 20;
+
+  std::vector<PositionKey> keys;
+  keys.reserve(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    PositionKey k{};
+    k.instrument = i;
+    k.account = i % 97;
+    k.venue = static_cast<std::uint32_t>(i % 13);
+    k.book = static_cast<std::uint32_t>(i % 7);
+    k.trader = i % 31;
+    k.symbol = "SYM" + std::to_string(i % 500);
+    keys.push_back(std::move(k));
+  }
+
+  // NOTE: insert and look the keys up in random orders, the member by member
+  // hash of sequential keys puts the nodes inserted one after the other in
+  // neighbouring buckets which hides the cache misses of the lookups
+  std::shuffle(keys.begin(), keys.end(), std::mt19937{7});
+  auto lookups = keys;
+  std::shuffle(lookups.begin(), lookups.end(), std::mt19937{42});
+
+  run<naive::hash>("member by member", keys, lookups, iterations);
+  run<std::hash<PositionKey>>("generated", keys, lookups, iterations);
+  return 0;
+}
@@ -0,0 +1,247 @@
+#ifndef BENCH_CORPUS_H
+#define BENCH_CORPUS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string>
+
+/**
+ * Deterministic generator of synthetic C++ headers for the parser
+ * benchmarks, the same options always give the same sources
+ *
+ * The sources only use constructs covered by the std parser tests:
+ * deep namespaces, class templates with bases, enums, long functions
+ * with declarations, if statements, lambdas and nested expressions,
+ * optionally with meta class functions and classes using them
+ */
+namespace corpus {
+struct Options {
+  std::size_t classes = 40;
+  std::size_t members = 8;
+  std::size_t functions = 40;
+  std::size_t statements = 24;
+  std::size_t namespace_depth = 4;
+  std::size_t expression_depth = 4;
+  std::size_t includes = 8;
+  std::size_t meta_classes = 0;
+  std::uint32_t seed = 42;
+};
+
+class Generator {
+  Options options;
+  std::uint32_t state;
+  std::size_t id = 0;
+
+  // NOTE: a fixed LCG so the corpus does not depend on the standard library
+  std::uint32_t next() {
+    state = state * 1664525u + 1013904223u;
+    return state >> 8;
+  }
+
+  std::size_t pick(std::size_t n) { return next() % n; }
+
+  char const* type() {
+    static char const* const types[] = {
+        "int",         "long",         "double",
+        "std::string", "std::size_t",  "std::vector<int>",
+        "bool",        "unsigned int", "std::pair<int, float>"};
+    return types[pick(std::size(types))];
+  }
+
+  std::string variable() { return "v" + std::to_string(pick(4)); }
+
+  void expression(std::string& out, std::size_t depth) {
+    if (depth == 0) {
+      if (pick(3) == 0) {
+        out += std::to_string(pick(100));
+      } else {
+        out += variable();
+      }
+      return;
+    }
+
+    static char const* const ops[] = {" + ", " - ", " * ", " / ", " % "};
+    switch (pick(4)) {
+      case 0:
+        out += '(';
+        expression(out, depth - 1);
+        out += ops[pick(std::size(ops))];
+        expression(out, depth - 1);
+        out += ')';
+        break;
+      case 1:
+        out += "std::min(";
+        expression(out, depth - 1);
+        out += ", ";
+        expression(out, depth - 1);
+        out += ')';
+        break;
+      case 2:
+        out += "foo(";
+        expression(out, depth - 1);
+        out += ", baz(";
+        expression(out, depth - 1);
+        out += ") * 2)";
+        break;
+      default:
+        expression(out, depth - 1);
+        out += ops[pick(std::size(ops))];
+        expression(out, depth - 1);
+        break;
+    }
+  }
+
+  void statement(std::string& out) {
+    switch (pick(5)) {
+      case 0:
+        out += "if (";
+        out += variable();
+        out += " < ";
+        out += std::to_string(pick(10));
+        out += ") { ";
+        out += variable();
+        out += " = ";
+        expression(out, 1);
+        out += "; } else { ";
+        out += variable();
+        out += " = 2; }\n";
+        break;
+      case 1:
+        out += "auto l";
+        out += std::to_string(id++);
+        out += " = [] (int j = 2) { return j + 2;};\n";
+        break;
+      case 2:
+        out += "std::vector<int> w";
+        out += std::to_string(id++);
+        out += " {1, 2, 3};\n";
+        break;
+      default:
+        out += "int i";
+        out += std::to_string(id++);
+        out += " = ";
+        expression(out, options.expression_depth);
+        out += ";\n";
+        break;
+    }
+  }
+
+  void function(std::string& out) {
+    out += "int function";
+    out += std::to_string(id++);
+    out += "(int v0, int v1, long v2 = 3l, int v3 = 2) {\n";
+    for (std::size_t i = 0; i < options.statements; ++i) {
+      statement(out);
+    }
+    out += "return v0;\n}\n\n";
+  }
+
+  void meta_class(std::string& out, std::size_t i) {
+    out += "constexpr void meta";
+    out += std::to_string(i);
+    out += "(meta::type target, const meta::type source) {\n"
+           "  for (auto m : source.members_and_bases())\n"
+           "    ->(target) m;\n"
+           "  for (auto f : source.functions()) {\n"
+           "    compiler.require(!f.is_virtual(), \"no virtual functions\");\n"
+           "    if (!f.has_access()) f.make_public();\n"
+           "  }\n"
+           "}\n\n";
+  }
+
+  void class_(std::string& out) {
+    auto name = "Class" + std::to_string(id++);
+    bool is_template = pick(3) == 0;
+    bool is_meta = !is_template && options.meta_classes > 0 && pick(2) == 0;
+    if (is_template) {
+      out += "template <class T>\n";
+    }
+    if (is_meta) {
+      out += "meta";
+      out += std::to_string(pick(options.meta_classes));
+    } else {
+      out += "struct";
+    }
+    out += ' ';
+    out += name;
+    if (pick(2) == 0) {
+      out += " : Base";
+      out += std::to_string(pick(8));
+    }
+    out += " {\n";
+    for (std::size_t i = 0; i < options.members; ++i) {
+      out += is_template && i == 0 ? "T" : type();
+      out += " m";
+      out += std::to_string(i);
+      out += ";\n";
+    }
+
+    if (pick(2) == 0) {
+      out += "enum class Kind { first, second, third };\n";
+    }
+
+    out += "\n private:\n int hidden;\n};\n\n";
+  }
+
+ public:
+  explicit Generator(Options options)
+      : options{options}, state{options.seed} {}
+
+  /**
+   * Generate one header, the classes and the functions are interleaved
+   */
+  std::string generate() {
+    std::string out;
+    out.reserve(64 * 1024);
+    out += "#pragma once\n";
+    for (std::size_t i = 0; i < options.includes; ++i) {
+      if (i % 2) {
+        out += "#include <vector>\n";
+      } else {
+        out += "#include \"dependency";
+        out += std::to_string(i);
+        out += ".hpp\"\n";
+      }
+    }
+    out += '\n';
+
+    for (std::size_t i = 0; i < options.meta_classes; ++i) {
+      meta_class(out, i);
+    }
+
+    for (std::size_t i = 0; i < options.namespace_depth; ++i) {
+      out += "namespace ns";
+      out += std::to_string(i);
+      out += " {\n";
+    }
+
+    std::size_t classes = 0;
+    std::size_t functions = 0;
+    while (classes < options.classes || functions < options.functions) {
+      bool add_class = functions == options.functions ||
+                       (classes < options.classes && pick(2) == 0);
+      if (add_class) {
+        class_(out);
+        ++classes;
+      } else {
+        function(out);
+        ++functions;
+      }
+
+      if (pick(8) == 0) {
+        out += "enum class Enum";
+        out += std::to_string(id++);
+        out += " { a, b, c, d };\n\n";
+      }
+    }
+
+    for (std::size_t i = 0; i < options.namespace_depth; ++i) {
+      out += "}\n";
+    }
+    return out;
+  }
+};
+}  // namespace corpus
+
+#endif  // BENCH_CORPUS_H
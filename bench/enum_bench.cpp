@@ -0,0 +1,95 @@
+// Enum to and from string conversions of reflect.hpp against a linear scan
+// over the generated enumerator arrays
+//
+// usage: enum_bench [conversions]
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <enum_bench_enums.hpp>
+
+using meta = reflexpr<Field>;
+
+namespace linear {
+std::string_view to_string(Field f) {
+  for (std::size_t i = 0; i < meta::enumerator_constants.size(); ++i) {
+    if (meta::enumerator_constants[i] == f) {
+      return meta::enumerator_names[i];
+    }
+  }
+  return {};
+}
+
+std::optional<Field> from_string(std::string_view name) {
+  for (std::size_t i = 0; i < meta::enumerator_names.size(); ++i) {
+    if (name == meta::enumerator_names[i]) {
+      return meta::enumerator_constants[i];
+    }
+  }
+  return std::nullopt;
+}
+}  // namespace linear
+
+// compile time checks of the generated tables
+static_assert(reflect::enum_to_string(Field{}) == meta::enumerator_names[0]);
+static_assert(reflect::enum_from_string<Field>(meta::enumerator_names[1]) ==
+              meta::enumerator_constants[1]);
+static_assert(!reflect::enum_from_string<Field>("not_a_field"));
+
+template <class F>
+double measure(F f) {
+  auto start = std::chrono::steady_clock::now();
+  f();
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+int main(int argc, char* argv[]) {
+  int conversions = argc > 1 ? std::atoi(argv[1]) : 10'000'000;
+
+  std::mt19937 gen{42};
+  std::uniform_int_distribution<int> pick{0, field_count - 1};
+  std::vector<Field> fields(conversions);
+  std::vector<std::string> names(conversions);
+  for (int i = 0; i < conversions; ++i) {
+    fields[i] = static_cast<Field>(pick(gen));
+    names[i] = meta::enumerator_names[static_cast<int>(fields[i])];
+  }
+
+  // sum up the results so the conversions are not optimized away
+  std::size_t sink = 0;
+  auto report = [&](char const* name, double seconds) {
+    std::cout << name << ": " << conversions / seconds / 1e6
+              << " M conversions/s\n";
+  };
+
+  report("linear to_string", measure([&] {
+           for (auto f : fields) {
+             sink += linear::to_string(f).size();
+           }
+         }));
+  report("reflect::enum_to_string", measure([&] {
+           for (auto f : fields) {
+             sink += reflect::enum_to_string(f).size();
+           }
+         }));
+  report("linear from_string", measure([&] {
+           for (auto& n : names) {
+             sink += static_cast<int>(*linear::from_string(n));
+           }
+         }));
+  report("reflect::enum_from_string", measure([&] {
+           for (auto& n : names) {
+             sink += static_cast<int>(*reflect::enum_from_string<Field>(n));
+           }
+         }));
+
+  return sink == 0;
+}
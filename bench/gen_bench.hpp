@@ -0,0 +1,57 @@
+#ifndef BENCH_GEN_BENCH_H
+#define BENCH_GEN_BENCH_H
+
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <static_reflection.hpp>
+
+/**
+ * Shared by the generators of the reflection benchmarks, which generate
+ * the reflection of the classes they build without any parsing
+ */
+namespace gen_bench {
+namespace ast = std_parser::rules::ast;
+
+struct NoParent {
+  inline static constexpr int std_parser_id = 's' + 't' + 'd';
+};
+
+using Parser = static_reflection::StaticReflexParser<NoParent>;
+
+/**
+ * A data member of a type named by a single identifier, e.g. std::string
+ */
+inline ast::var make_var(std::string type, std::string name) {
+  ast::var v;
+  v.type.type.type.push_back(ast::unqulified_type{{std::move(type)}, {}});
+  v.name = std::move(name);
+  return v;
+}
+
+/**
+ * Define the struct with the public data members, given as type and name,
+ * followed by its reflection
+ */
+inline std::string gen_struct(
+    Parser& parser, std::string name,
+    std::vector<std::pair<std::string, std::string>> const& members) {
+  ast::class_or_struct cs;
+  cs.type = ast::class_type::STRUCT;
+  cs.name = name;
+  ast::Class cls{std::move(cs)};
+
+  std::string out = "struct " + name + " {\n";
+  for (auto& [type, member] : members) {
+    out += type + ' ' + member + ";\n";
+    cls.public_members.push_back(make_var(type, member));
+  }
+  out += parser.generate_reflection(cls);
+  out += "\n\n";
+  return out;
+}
+}  // namespace gen_bench
+
+#endif  //! BENCH_GEN_BENCH_H
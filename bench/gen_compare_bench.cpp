@@ -0,0 +1,40 @@
+// Generates the reflection with comparisons of the struct used by
+// compare_bench
+//
+// usage: gen_compare_bench out_header
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gen_bench.hpp>
+
+using namespace gen_bench;
+
+int main(int argc, char* argv[]) {
+  if (argc != 2) {
+    std::cout << "usage: " << argv[0] << " out_header\n";
+    return 1;
+  }
+
+  NoParent parent;
+  Parser parser{parent, Parser::Representation::Flat, false, false, true};
+
+  std::vector<std::pair<std::string, std::string>> members = {
+      {"std::uint64_t", "instrument"}, {"std::uint64_t", "account"},
+      {"std::uint32_t", "venue"},      {"std::uint32_t", "book"},
+      {"std::int64_t", "strategy"},    {"std::int64_t", "desk"},
+      {"std::uint32_t", "region"},     {"std::uint32_t", "currency"},
+      {"std::uint64_t", "session"},    {"std::uint64_t", "trader"},
+      {"std::string", "symbol"}};
+
+  std::string out = "#include <cstdint>\n#include <string>\n\n";
+  out += parser.get_prepend();
+  out += '\n';
+  out += gen_struct(parser, "PositionKey", members);
+
+  std::ofstream{argv[1]} << out;
+  return 0;
+}
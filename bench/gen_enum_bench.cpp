@@ -0,0 +1,52 @@
+// Generates the reflection of the enums used by enum_bench
+//
+// usage: gen_enum_bench out_header [enumerators]
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include <gen_bench.hpp>
+
+using namespace gen_bench;
+
+// log field names of different lengths with a shared prefix
+std::string enumerator(int i) {
+  const char* words[] = {"request", "response", "status", "latency",
+                         "user",    "session",  "error",  "bytes"};
+  return std::string{"field_"} + words[i % std::size(words)] + '_' +
+         std::to_string(i);
+}
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    std::cout << "usage: " << argv[0] << " out_header [enumerators]\n";
+    return 1;
+  }
+  int enumerators = argc > 2 ? std::atoi(argv[2]) : 64;
+
+  NoParent parent;
+  Parser parser{parent};
+
+  ast::enum_ e;
+  e.type = ast::EnumType::ENUM_CLASS;
+  e.name = "Field";
+  e.as = {"int"};
+  ast::Enumeration enumeration{std::move(e)};
+
+  std::string out = "#include <reflect.hpp>\n\n";
+  out += "enum class Field : int {\n";
+  std::vector<std::string> names;
+  for (int i = 0; i < enumerators; ++i) {
+    names.push_back(enumerator(i));
+    out += names.back() + ",\n";
+  }
+  enumeration.set_enumerators(std::move(names));
+  out += parser.generate_reflection(enumeration);
+  out += "\n\nconstexpr int field_count = " + std::to_string(enumerators) +
+         ";\n";
+
+  std::ofstream{argv[1]} << out;
+  return 0;
+}
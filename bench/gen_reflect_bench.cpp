@@ -0,0 +1,98 @@
+// Generates two translation units with the same synthetic large structs,
+// one reflected with the tuple and one with the flat representation
+//
+// usage: gen_reflect_bench out_dir [structs] [members]
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <gen_bench.hpp>
+
+namespace fs = std::filesystem;
+using namespace gen_bench;
+
+std::string gen_source(Parser::Representation representation, int structs,
+                       int members) {
+  NoParent parent;
+  Parser parser{parent, representation};
+  const char* types[] = {"int", "double", "char", "long", "float"};
+
+  std::string out;
+  out += "#include <cstddef>\n#include <string_view>\n#include <utility>\n\n";
+  out += "#include <reflect.hpp>\n\n";
+  for (int s = 0; s < structs; ++s) {
+    ast::class_or_struct cs;
+    cs.type = ast::class_type::STRUCT;
+    cs.name = "S" + std::to_string(s);
+    ast::Class cls{std::move(cs)};
+
+    out += "struct " + cls.name + " {\n";
+    for (int m = 0; m < members; ++m) {
+      ast::var v;
+      v.name = "m" + std::to_string(m);
+      // the last quarter of the members is private
+      bool is_private = m >= members * 3 / 4;
+      if (is_private && m == members * 3 / 4) {
+        out += "private:\n";
+      }
+      out += types[m % std::size(types)] + std::string(" ") + v.name + ";\n";
+      (is_private ? cls.private_members : cls.public_members).push_back(v);
+    }
+    out += parser.generate_reflection(cls);
+    out += "\n\n";
+  }
+
+  // touch every member's pointer, type and name
+  out += R"(
+template <class Members, class T, std::size_t... Is>
+std::size_t visit(T const& t, std::index_sequence<Is...>) {
+  return (0 + ... +
+          (sizeof(reflect::get_type_t<reflect::get_element_t<Is, Members>>) +
+           sizeof(t.*reflect::get_pointer_v<reflect::get_element_t<Is, Members>>) +
+           std::string_view{reflect::get_name_v<reflect::get_element_t<Is, Members>>}.size()));
+}
+
+template <class T>
+std::size_t visit_all(T const& t) {
+  using meta = reflexpr<T>;
+  using members = reflect::get_data_members_t<meta>;
+  using public_members = reflect::get_public_data_members_t<meta>;
+  return visit<members>(t, std::make_index_sequence<reflect::get_size_v<members>>{}) +
+         visit<public_members>(t, std::make_index_sequence<reflect::get_size_v<public_members>>{});
+}
+
+int main() {
+  std::size_t total = 0;
+)";
+  for (int s = 0; s < structs; ++s) {
+    out += "  total += visit_all(S" + std::to_string(s) + "{});\n";
+  }
+  out += "  return static_cast<int>(total % 2);\n}\n";
+
+  return out;
+}
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    std::cout << "usage: " << argv[0] << " out_dir [structs] [members]\n";
+    return 1;
+  }
+
+  fs::path out_dir = argv[1];
+  int structs = argc > 2 ? std::atoi(argv[2]) : 20;
+  int members = argc > 3 ? std::atoi(argv[3]) : 150;
+
+  fs::create_directories(out_dir);
+  std::ofstream{out_dir / "reflect_tuple.cpp"}
+      << gen_source(Parser::Representation::Tuple, structs, members);
+  std::ofstream{out_dir / "reflect_flat.cpp"}
+      << gen_source(Parser::Representation::Flat, structs, members);
+
+  std::cout << "generated " << structs << " structs with " << members
+            << " members in " << out_dir << '\n';
+  return 0;
+}
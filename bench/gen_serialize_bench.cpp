@@ -0,0 +1,51 @@
+// Generates the reflection with serializers of the structs used by
+// serialize_bench
+//
+// usage: gen_serialize_bench out_header
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gen_bench.hpp>
+
+using namespace gen_bench;
+
+int main(int argc, char* argv[]) {
+  if (argc != 2) {
+    std::cout << "usage: " << argv[0] << " out_header\n";
+    return 1;
+  }
+
+  NoParent parent;
+  // NOTE: with the comparisons for the round trip check of the benchmark
+  Parser parser{parent, Parser::Representation::Flat, true, false, true};
+
+  std::string out;
+  out += "#include <cstdint>\n#include <string>\n#include <vector>\n\n";
+  out += parser.get_prepend();
+  out += '\n';
+  out += gen_struct(parser, "Fill",
+                    {{"std::uint64_t", "id"},
+                     {"double", "price"},
+                     {"std::uint32_t", "quantity"},
+                     {"std::uint32_t", "venue"}});
+  out += gen_struct(parser, "Order",
+                    {{"std::uint64_t", "id"},
+                     {"std::uint64_t", "timestamp"},
+                     {"double", "price"},
+                     {"double", "stop_price"},
+                     {"std::uint32_t", "quantity"},
+                     {"std::uint32_t", "flags"},
+                     {"std::string", "symbol"},
+                     {"std::string", "account"},
+                     {"std::vector<Fill>", "fills"},
+                     {"std::int64_t", "parent_id"},
+                     {"std::int32_t", "side"},
+                     {"std::int32_t", "type"}});
+
+  std::ofstream{argv[1]} << out;
+  return 0;
+}
@@ -0,0 +1,40 @@
+// Generates the reflection with soa_vector accessors of the struct used by
+// soa_bench
+//
+// usage: gen_soa_bench out_header
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gen_bench.hpp>
+
+using namespace gen_bench;
+
+int main(int argc, char* argv[]) {
+  if (argc != 2) {
+    std::cout << "usage: " << argv[0] << " out_header\n";
+    return 1;
+  }
+
+  NoParent parent;
+  Parser parser{parent, Parser::Representation::Flat, false, true};
+
+  // the position and the velocity among other fields the kernel never reads
+  std::vector<std::pair<std::string, std::string>> members;
+  for (auto name : {"x", "y", "z", "vx", "vy", "vz"}) {
+    members.emplace_back("double", name);
+  }
+  for (int i = 0; i < 14; ++i) {
+    members.emplace_back("double", "extra" + std::to_string(i));
+  }
+
+  std::string out = parser.get_prepend();
+  out += '\n';
+  out += gen_struct(parser, "Particle", members);
+
+  std::ofstream{argv[1]} << out;
+  return 0;
+}
@@ -0,0 +1,205 @@
+// Throughput of the std parser on a synthetic corpus: StdParser::parse,
+// StdParser::get_includes, Preprocessor::process_source with the std parser
+// alone and with the ReusingStdParser after editing one declaration, and
+// Preprocessor::process_source with the meta class, the static reflection
+// and the std parser
+//
+// usage: parser_bench corpus_dir [files] [iterations]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <cctype>
+
+#include <corpus.hpp>
+#include <incremental_parser.hpp>
+#include <meta_classes.hpp>
+#include <preprocessor.hpp>
+#include <source_loader.hpp>
+#include <static_reflection.hpp>
+#include <std_parser.hpp>
+
+struct Measure {
+  double seconds = 0;
+  std::size_t bytes = 0;
+  std::size_t statements = 0;
+};
+
+/**
+ * Run f iterations times and keep the fastest run
+ */
+template <class F>
+Measure best_of(int iterations, F&& f) {
+  Measure best;
+  for (int i = 0; i < iterations; ++i) {
+    auto start = std::chrono::steady_clock::now();
+    Measure m = f();
+    std::chrono::duration<double> time =
+        std::chrono::steady_clock::now() - start;
+    m.seconds = time.count();
+    if (i == 0 || m.seconds < best.seconds) {
+      best = m;
+    }
+  }
+  return best;
+}
+
+void report(char const* name, Measure const& m) {
+  double mb = static_cast<double>(m.bytes) / (1024 * 1024);
+  std::cout << name << ": " << mb / m.seconds << " MB/s";
+  if (m.statements > 0) {
+    std::cout << ", " << m.statements / m.seconds << " statements/s";
+  }
+  std::cout << " (" << m.seconds * 1000 << " ms)\n";
+}
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    std::cout << "usage: " << argv[0] << " corpus_dir [files] [iterations]\n";
+    return 1;
+  }
+
+  fs::path dir = argv[1];
+  std::size_t files = argc > 2 ? std::atoll(argv[2]) : 8;
+  int iterations = argc > 3 ? std::atoi(argv[3]) : 3;
+
+  std::vector<std::string> paths;
+  for (std::size_t i = 0; i < files; ++i) {
+    corpus::Options options;
+    options.seed = static_cast<std::uint32_t>(i + 1);
+    auto path = (dir / ("corpus" + std::to_string(i) + ".hpp")).string();
+    source::write_if_changed(path, corpus::Generator{options}.generate());
+    paths.push_back(std::move(path));
+  }
+
+  source::SourceLoader loader{{}, dir / "out"};
+  std::vector<Source> sources;
+  std::size_t bytes = 0;
+  for (auto& path : paths) {
+    sources.push_back(loader.load_source(path));
+    bytes += std::distance(sources.back().begin(), sources.back().end());
+  }
+  std::cout << "corpus: " << files << " files, " << bytes << " bytes\n";
+
+  auto parse = best_of(iterations, [&] {
+    Measure m{0, bytes, 0};
+    for (auto source : sources) {
+      std_parser::StdParser parser;
+      while (!source.is_finished()) {
+        auto out = parser.parse(source);
+        if (!out) {
+          throw std::runtime_error("can't parse " + source.get_name());
+        }
+        source.advance(std::distance(source.begin(), out->processed_to));
+        ++m.statements;
+      }
+    }
+    return m;
+  });
+  report("StdParser::parse", parse);
+
+  auto includes = best_of(iterations, [&] {
+    Measure m{0, bytes, 0};
+    for (auto source : sources) {
+      std_parser::StdParser parser;
+      m.statements += parser.get_includes(source).size();
+    }
+    return m;
+  });
+  includes.statements = 0;
+  report("StdParser::get_includes", includes);
+
+  // NOTE: a number in the middle of each file is flipped between 0 and 1
+  // so every reparse has exactly one changed declaration
+  std::vector<std::string> contents;
+  std::vector<std::size_t> edits;
+  for (auto& source : sources) {
+    contents.emplace_back(source.begin(), source.end());
+    auto& content = contents.back();
+    auto at = content.size() / 2;
+    while (at < content.size() &&
+           !(std::isdigit(static_cast<unsigned char>(content[at])) &&
+             !std::isalnum(static_cast<unsigned char>(content[at - 1])) &&
+             content[at - 1] != '_')) {
+      ++at;
+    }
+    edits.push_back(at);
+  }
+
+  // NOTE: the same Preprocessor type every time, the ReusingStdParser keeps
+  // the versions of the sources per type
+  auto reusing_parser = [](auto& parent) {
+    return std_parser::incremental::ReusingStdParser{parent};
+  };
+  auto plain_parser = [](auto&) { return std_parser::StdParser{}; };
+  std::size_t reused = 0;
+  auto process_edited = [&](auto std_parser) {
+    for (std::size_t i = 0; i < contents.size(); ++i) {
+      if (edits[i] < contents[i].size()) {
+        contents[i][edits[i]] = contents[i][edits[i]] == '0' ? '1' : '0';
+      }
+      source::write_if_changed(paths[i], contents[i]);
+    }
+
+    Preprocessor preprocessor(source::SourceLoader{{}, dir / "out"},
+                              std_parser);
+    std::string out;
+    auto writer = [&out](auto& src) { out.append(src.begin(), src.end()); };
+    reused = 0;
+    for (auto& path : paths) {
+      out.clear();
+      preprocessor.process_source(path, writer);
+      if constexpr (std::is_same_v<decltype(std_parser),
+                                   decltype(reusing_parser)>) {
+        reused += preprocessor
+                      .template get_parser<
+                          decltype(preprocessor)::std_parser_id>()
+                      .get_reused_chunks();
+      }
+    }
+    return Measure{0, bytes, parse.statements};
+  };
+
+  auto plain = best_of(iterations, [&] { return process_edited(plain_parser); });
+  report("Preprocessor::process_source, StdParser", plain);
+
+  std_parser::incremental::enable_reuse();
+  process_edited(reusing_parser);
+  auto reusing =
+      best_of(iterations, [&] { return process_edited(reusing_parser); });
+  report("Preprocessor::process_source, ReusingStdParser", reusing);
+  std::cout << "ReusingStdParser reused " << reused << " chunks of " << files
+            << " files\n";
+
+  auto process = best_of(iterations, [&] {
+    source::SourceLoader loader{{}, dir / "out"};
+    auto meta_classes = [](auto& parent) {
+      return meta_classes::MetaClassParser{parent, "", "", ""};
+    };
+    auto static_ref = [](auto& parent) {
+      using Parser = static_reflection::StaticReflexParser<
+          std::remove_reference_t<decltype(parent)>>;
+      return Parser{parent};
+    };
+    auto std_parser = [](auto&) { return std_parser::StdParser{}; };
+    Preprocessor preprocessor(std::move(loader), meta_classes, static_ref,
+                              std_parser);
+
+    std::string out;
+    auto writer = [&out](auto& src) { out.append(src.begin(), src.end()); };
+    for (auto& path : paths) {
+      out.clear();
+      preprocessor.process_source(path, writer);
+    }
+    return Measure{0, bytes, parse.statements};
+  });
+  report("Preprocessor::process_source", process);
+
+  return 0;
+}
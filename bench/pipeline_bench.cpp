@@ -0,0 +1,281 @@
+// End to end benchmark of the preprocess() pipeline on the examples: runs
+// stages 1, 2 and 3 of main on copies of the example sources the same way
+// the CMake function does and reports per stage the wall time, the peak RSS
+// and the number of processes started
+//
+// usage: pipeline_bench main_exe preprocessor_dir work_dir compiler
+//                       [copies] [--build-meta]
+//
+// the optional args can come in any order
+//
+// each copy is its own target with its own meta executable, with
+// --build-meta the meta executables are built and timed as a stage,
+// otherwise one meta executable per example is built before and reused
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+struct Stage {
+  std::string name;
+  double seconds = 0;
+  long peak_rss_kb = 0;
+  std::size_t processes = 0;
+};
+
+/**
+ * Run the command in dir with its output in log and add its wall time,
+ * its peak RSS (with the one of its children) and itself to stage
+ */
+void run(Stage& stage, std::vector<std::string> const& command,
+         fs::path const& dir, fs::path const& log) {
+  std::vector<char*> args;
+  for (auto& arg : command) {
+    args.push_back(const_cast<char*>(arg.c_str()));
+  }
+  args.push_back(nullptr);
+
+  auto start = std::chrono::steady_clock::now();
+  pid_t pid = fork();
+  if (pid < 0) {
+    throw std::runtime_error("can't fork");
+  }
+  if (pid == 0) {
+    int fd = open(log.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd >= 0) {
+      dup2(fd, STDOUT_FILENO);
+      dup2(fd, STDERR_FILENO);
+      close(fd);
+    }
+    if (chdir(dir.c_str()) == 0) {
+      execvp(args[0], args.data());
+    }
+    _exit(127);
+  }
+
+  // NOTE: the usage of the child also covers its waited for children, e.g.
+  // the meta process or the compiler driver's subprocesses
+  int status = 0;
+  rusage usage{};
+  if (wait4(pid, &status, 0, &usage) < 0) {
+    throw std::runtime_error("can't wait for " + command[0]);
+  }
+  std::chrono::duration<double> time =
+      std::chrono::steady_clock::now() - start;
+
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    throw std::runtime_error(command[0] + " failed, see " + log.string());
+  }
+
+  stage.seconds += time.count();
+  stage.peak_rss_kb = std::max(stage.peak_rss_kb, usage.ru_maxrss);
+  ++stage.processes;
+}
+
+/**
+ * Wrapper of the meta executable counting the meta processes started by
+ * stage 3, exec keeps the process so its usage is still the meta's one
+ */
+fs::path counting_wrapper(fs::path const& meta, fs::path const& counter) {
+  auto wrapper = fs::path{meta}.concat(".counted");
+  std::ofstream out{wrapper};
+  out << "#!/bin/sh\n"
+      << "echo >> '" << counter.string() << "'\n"
+      << "exec '" << meta.string() << "' \"$@\"\n";
+  out.close();
+  fs::permissions(wrapper, fs::perms::owner_all, fs::perm_options::add);
+  return wrapper;
+}
+
+std::size_t count_lines(fs::path const& path) {
+  std::ifstream in{path};
+  return std::count(std::istreambuf_iterator<char>{in},
+                    std::istreambuf_iterator<char>{}, '\n');
+}
+
+struct Copy {
+  fs::path root;
+  fs::path build;
+  std::vector<fs::path> sources;
+  std::vector<std::string> include_dirs;
+  fs::path meta;
+};
+
+/**
+ * Copy the sources and the headers of the example, its include directories
+ * are the ones of the example's CMakeLists.txt
+ */
+Copy make_copy(fs::path const& example, fs::path const& root) {
+  Copy copy{root, root / "build", {}, {}, {}};
+  fs::remove_all(root);
+  fs::create_directories(copy.build);
+  for (auto dir : {"src", "include"}) {
+    if (fs::exists(example / dir)) {
+      fs::copy(example / dir, root / dir, fs::copy_options::recursive);
+    }
+  }
+  for (auto& entry : fs::directory_iterator{root / "src"}) {
+    copy.sources.push_back(entry.path());
+  }
+  std::sort(copy.sources.begin(), copy.sources.end());
+  if (fs::exists(root / "include")) {
+    copy.include_dirs.push_back((root / "include").string());
+  }
+  copy.include_dirs.push_back(root.string());
+  return copy;
+}
+
+std::string includes_file(Copy const& copy, std::size_t index) {
+  return (copy.build / "out" / ("includes" + std::to_string(index) + ".txt"))
+      .string();
+}
+
+std::vector<std::string> meta_build_command(std::string const& compiler,
+                                            fs::path const& preprocessor_dir,
+                                            Copy const& copy,
+                                            fs::path const& meta) {
+  auto meta_include = preprocessor_dir / "extern/meta_classes/meta_include";
+  std::vector<std::string> command{
+      compiler,
+      "-std=c++17",
+      "-I" + meta_include.string(),
+      "-I" + (copy.build / "meta_out").string(),
+      "-I" + (preprocessor_dir / "extern/static_reflection/out_include")
+                 .string()};
+  for (auto& source : copy.sources) {
+    command.push_back((copy.build / "meta_out" / source.filename()).string());
+  }
+  command.push_back((meta_include / "meta_main.cpp").string());
+  command.push_back("-o");
+  command.push_back(meta.string());
+  command.push_back("-pthread");
+  return command;
+}
+
+int main(int argc, char* argv[]) {
+  if (argc < 5) {
+    std::cout << "usage: " << argv[0]
+              << " main_exe preprocessor_dir work_dir compiler [copies]"
+                 " [--build-meta]\n";
+    return 1;
+  }
+
+  std::string main_exe = fs::absolute(argv[1]).string();
+  fs::path preprocessor_dir = fs::absolute(argv[2]);
+  fs::path work_dir = fs::absolute(argv[3]);
+  std::string compiler = argv[4];
+  std::size_t copies = 4;
+  bool build_meta = false;
+  for (int i = 5; i < argc; ++i) {
+    if (std::string_view{argv[i]} == "--build-meta") {
+      build_meta = true;
+    } else {
+      copies = std::atoll(argv[i]);
+    }
+  }
+
+  fs::create_directories(work_dir);
+  fs::path log = work_dir / "pipeline.log";
+  fs::path counter = work_dir / "meta_processes.txt";
+  fs::remove(log);
+  fs::remove(counter);
+
+  std::vector<Copy> targets;
+  Stage untimed{"meta build"};
+  for (auto example : {"meta_classes", "static_reflection"}) {
+    fs::path example_meta;
+    for (std::size_t i = 0; i < copies; ++i) {
+      auto copy = make_copy(preprocessor_dir / "examples" / example,
+                            work_dir / example / ("copy" + std::to_string(i)));
+      if (build_meta || i == 0) {
+        copy.meta = copy.build / "meta";
+      } else {
+        copy.meta = example_meta;
+      }
+      example_meta = copy.meta;
+      targets.push_back(std::move(copy));
+    }
+  }
+
+  Stage stages[] = {{"stage 1 (includes)"},
+                    {"stage 2 (meta classes)"},
+                    {"meta build"},
+                    {"stage 3 (process)"}};
+
+  for (auto& copy : targets) {
+    for (std::size_t i = 0; i < copy.sources.size(); ++i) {
+      std::vector<std::string> command{main_exe, "1", copy.sources[i].string(),
+                                       includes_file(copy, i + 1)};
+      command.insert(command.end(), copy.include_dirs.begin(),
+                     copy.include_dirs.end());
+      run(stages[0], command, copy.build, log);
+    }
+  }
+
+  for (auto& copy : targets) {
+    for (std::size_t i = 0; i < copy.sources.size(); ++i) {
+      run(stages[1],
+          {main_exe, "2", copy.sources[i].string(), includes_file(copy, i + 1),
+           (copy.build / "meta_out").string()},
+          copy.build, log);
+    }
+  }
+
+  // NOTE: without --build-meta the copies reuse the meta executable of the
+  // first copy of their example, its meta output is the same
+  for (auto& copy : targets) {
+    if (copy.meta != copy.build / "meta") {
+      continue;
+    }
+    auto& stage = build_meta ? stages[2] : untimed;
+    run(stage, meta_build_command(compiler, preprocessor_dir, copy, copy.meta),
+        copy.build, log);
+  }
+
+  for (auto& copy : targets) {
+    auto meta = counting_wrapper(copy.meta, counter);
+    for (std::size_t i = 0; i < copy.sources.size(); ++i) {
+      run(stages[3],
+          {main_exe, "3", copy.sources[i].string(),
+           (copy.build / copy.sources[i].filename()).string(),
+           includes_file(copy, i + 1), meta.string()},
+          copy.build, log);
+    }
+  }
+  stages[3].processes += count_lines(counter);
+
+  std::cout << "pipeline on " << copies << " copies of the examples";
+  std::cout << (build_meta ? ", meta build included\n"
+                           : ", meta build excluded\n");
+  Stage total{"total"};
+  for (auto& stage : stages) {
+    if (!build_meta && &stage == &stages[2]) {
+      continue;
+    }
+    std::cout << stage.name << ": " << stage.seconds * 1000 << " ms, peak RSS "
+              << stage.peak_rss_kb << " KB, " << stage.processes
+              << " processes\n";
+    total.seconds += stage.seconds;
+    total.peak_rss_kb = std::max(total.peak_rss_kb, stage.peak_rss_kb);
+    total.processes += stage.processes;
+  }
+  std::cout << total.name << ": " << total.seconds * 1000 << " ms, peak RSS "
+            << total.peak_rss_kb << " KB, " << total.processes
+            << " processes\n";
+  return 0;
+}
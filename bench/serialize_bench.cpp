@@ -0,0 +1,176 @@
+// Throughput of the generated serializers against a naive member by member
+// serializer of the same wire format
+//
+// usage: serialize_bench [objects] [iterations]
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <serialize_structs.hpp>
+
+namespace naive {
+using reflect::serial::Reader;
+using reflect::serial::Writer;
+
+template <class T>
+void put(Writer& w, T const& v) {
+  w.write(&v, sizeof(v));
+}
+
+void put(Writer& w, std::string const& s) {
+  std::uint64_t size = s.size();
+  put(w, size);
+  w.write(s.data(), s.size());
+}
+
+void put(Writer& w, Fill const& f) {
+  put(w, f.id);
+  put(w, f.price);
+  put(w, f.quantity);
+  put(w, f.venue);
+}
+
+void put(Writer& w, Order const& o) {
+  put(w, o.id);
+  put(w, o.timestamp);
+  put(w, o.price);
+  put(w, o.stop_price);
+  put(w, o.quantity);
+  put(w, o.flags);
+  put(w, o.symbol);
+  put(w, o.account);
+  std::uint64_t fills = o.fills.size();
+  put(w, fills);
+  for (auto& f : o.fills) {
+    put(w, f);
+  }
+  put(w, o.parent_id);
+  put(w, o.side);
+  put(w, o.type);
+}
+
+template <class T>
+void get(Reader& r, T& v) {
+  r.read(&v, sizeof(v));
+}
+
+void get(Reader& r, std::string& s) {
+  std::uint64_t size = 0;
+  get(r, size);
+  if (size > r.remaining()) {
+    r.fail();
+    return;
+  }
+  s.resize(size);
+  r.read(s.data(), size);
+}
+
+void get(Reader& r, Fill& f) {
+  get(r, f.id);
+  get(r, f.price);
+  get(r, f.quantity);
+  get(r, f.venue);
+}
+
+void get(Reader& r, Order& o) {
+  get(r, o.id);
+  get(r, o.timestamp);
+  get(r, o.price);
+  get(r, o.stop_price);
+  get(r, o.quantity);
+  get(r, o.flags);
+  get(r, o.symbol);
+  get(r, o.account);
+  std::uint64_t fills = 0;
+  get(r, fills);
+  if (fills > r.remaining()) {
+    r.fail();
+    return;
+  }
+  o.fills.resize(fills);
+  for (auto& f : o.fills) {
+    get(r, f);
+  }
+  get(r, o.parent_id);
+  get(r, o.side);
+  get(r, o.type);
+}
+}  // namespace naive
+
+std::vector<Order> make_orders(int count) {
+  std::vector<Order> orders(count);
+  for (int i = 0; i < count; ++i) {
+    auto& o = orders[i];
+    o.id = i;
+    o.timestamp = 1'000'000 + i;
+    o.price = 100.25 + i;
+    o.stop_price = 99.5;
+    o.quantity = i % 1000;
+    o.flags = i & 0xff;
+    o.symbol = "SYM" + std::to_string(i % 500);
+    o.account = "account-" + std::to_string(i % 50);
+    o.fills.resize(i % 4);
+    for (auto& f : o.fills) {
+      f = Fill{static_cast<std::uint64_t>(i), 100.0, 10, 3};
+    }
+    o.parent_id = -i;
+    o.side = i % 2;
+    o.type = i % 3;
+  }
+  return orders;
+}
+
+template <class Write, class Read>
+void run(char const* name, std::vector<Order> const& orders, int iterations,
+         Write write, Read read) {
+  using clock = std::chrono::steady_clock;
+  std::string buffer;
+  std::vector<Order> decoded(orders.size());
+
+  clock::duration write_time{};
+  clock::duration read_time{};
+  for (int i = 0; i < iterations; ++i) {
+    buffer.clear();
+    auto start = clock::now();
+    reflect::serial::Writer w{buffer};
+    for (auto& o : orders) {
+      write(w, o);
+    }
+    write_time += clock::now() - start;
+
+    start = clock::now();
+    reflect::serial::Reader r{buffer};
+    for (auto& o : decoded) {
+      read(r, o);
+    }
+    read_time += clock::now() - start;
+    if (!r.good() || decoded != orders) {
+      std::cerr << name << ": round trip failed\n";
+      std::exit(1);
+    }
+  }
+
+  auto mb = static_cast<double>(buffer.size()) * iterations / (1024 * 1024);
+  auto seconds = [](auto d) {
+    return std::chrono::duration<double>(d).count();
+  };
+  std::cout << name << ": serialize " << mb / seconds(write_time)
+            << " MB/s, deserialize " << mb / seconds(read_time) << " MB/s\n";
+}
+
+int main(int argc, char* argv[]) {
+  int objects = argc > 1 ? std::atoi(argv[1]) : 100'000;
+  int iterations = argc > 2 ? std::atoi(argv[2]) : 20;
+
+  auto orders = make_orders(objects);
+  run("naive", orders, iterations,
+      [](auto& w, auto& o) { naive::put(w, o); },
+      [](auto& r, auto& o) { naive::get(r, o); });
+  run("generated", orders, iterations,
+      [](auto& w, auto& o) { reflect::serial::write(w, o); },
+      [](auto& r, auto& o) { reflect::serial::read(r, o); });
+  return 0;
+}
@@ -0,0 +1,79 @@
+// Time of a kernel touching three of twenty fields of a struct stored in a
+// std::vector against the same struct stored in a reflect::soa_vector
+//
+// usage: soa_bench [particles] [iterations]
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include <soa_bench_struct.hpp>
+#include <soa_vector.hpp>
+
+template <class F>
+double time_ms(F&& f) {
+  auto start = std::chrono::steady_clock::now();
+  f();
+  std::chrono::duration<double, std::milli> time =
+      std::chrono::steady_clock::now() - start;
+  return time.count();
+}
+
+int main(int argc, char* argv[]) {
+  std::size_t particles = argc > 1 ? std::atoll(argv[1]) : 1'000'000;
+  int iterations = argc > 2 ? std::atoi(argv[2]) : 100;
+  constexpr double dt = 0.01;
+
+  std::vector<Particle> aos;
+  reflect::soa_vector<Particle> soa;
+  aos.reserve(particles);
+  soa.reserve(particles);
+  for (std::size_t i = 0; i < particles; ++i) {
+    Particle p{};
+    p.vx = static_cast<double>(i % 7);
+    p.vy = static_cast<double>(i % 11);
+    p.vz = static_cast<double>(i % 13);
+    aos.push_back(p);
+    soa.push_back(p);
+  }
+
+  auto aos_ms = time_ms([&] {
+    for (int it = 0; it < iterations; ++it) {
+      for (auto& p : aos) {
+        p.x += p.vx * dt;
+        p.y += p.vy * dt;
+        p.z += p.vz * dt;
+      }
+    }
+  });
+
+  auto soa_ms = time_ms([&] {
+    for (int it = 0; it < iterations; ++it) {
+      double* x = soa.x().data();
+      double* y = soa.y().data();
+      double* z = soa.z().data();
+      double const* vx = soa.vx().data();
+      double const* vy = soa.vy().data();
+      double const* vz = soa.vz().data();
+      for (std::size_t i = 0; i < particles; ++i) {
+        x[i] += vx[i] * dt;
+        y[i] += vy[i] * dt;
+        z[i] += vz[i] * dt;
+      }
+    }
+  });
+
+  // NOTE: compare the results so neither loop is optimized away
+  double aos_sum = 0;
+  double soa_sum = 0;
+  for (std::size_t i = 0; i < particles; ++i) {
+    aos_sum += aos[i].x + aos[i].y + aos[i].z;
+    soa_sum += soa[i].x() + soa[i].y() + soa[i].z();
+  }
+
+  std::cout << "std::vector: " << aos_ms << " ms\n";
+  std::cout << "soa_vector:  " << soa_ms << " ms\n";
+  std::cout << "results " << (aos_sum == soa_sum ? "match" : "differ") << '\n';
+  return aos_sum == soa_sum ? 0 : 1;
+}
@@ -4,6 +4,7 @@
 
 #include <foo.h>
 #include <reflect.hpp>
+#include <soa_vector.hpp>
 
 template <std::size_t N, typename Members, std::size_t Size, typename T>
 bool compare_data_members(const T& a, const T& b) {
@@ -57,6 +58,18 @@ struct B : A<int> {
   int b;
 };
 
+struct Message {
+  struct Header {
+    int id;
+    int size;
+  };
+
+  enum class Kind { request, response };
+
+  Header header;
+  Kind kind;
+};
+
 enum class E {
   first, second
 };
@@ -105,6 +118,30 @@ int main() {
   std::cout << class_name << "::" << reflect::get_name_v<third> << " = "
             << bar.*ptr3 << std::endl;
 
+  // visit every data member
+  reflect::for_each_member(bar, [](auto name, auto const& value) {
+    std::cout << "Bar::" << name << " = " << value << std::endl;
+  });
+
+  // member layout tables for standard layout classes
+  using metaA = reflexpr(A<int>);
+  auto offsets = reflect::get_data_member_offsets_v<metaA>;
+  auto sizes = reflect::get_data_member_sizes_v<metaA>;
+  for (std::size_t i = 0; i < offsets.size(); ++i) {
+    std::cout << "A<int> member " << i << " at offset " << offsets[i]
+              << " of size " << sizes[i] << std::endl;
+  }
+
+  // one array per data member
+  reflect::soa_vector<Baz> bazs;
+  bazs.push_back(a);
+  bazs.push_back(b);
+  int sum = 0;
+  for (int value : bazs.column<&Baz::b>()) {
+    sum += value;
+  }
+  std::cout << "sum of Baz::b = " << sum << std::endl;
+
   // inheritance
   using metaB = reflexpr(B);
   using bases = reflect::get_public_base_classes_t<metaB>;
@@ -116,11 +153,23 @@ int main() {
   std::cout << "type " << name << " inherits from "
             << reflect::get_name_v<base1> << std::endl;
 
+  // nested types
+  using header_m = reflexpr(Message::Header);
+  std::cout << "type " << reflect::get_name_v<header_m> << " has "
+            << reflect::get_size_v<reflect::get_data_members_t<header_m>>
+            << " data members" << std::endl;
+  std::cout << reflect::enum_to_string(Message::Kind::response) << std::endl;
+
   // enums
 
   using E_m = reflexpr(E);
   using first_m = reflect::get_element_t<0, reflect::get_enumerators_t<E_m>>;
   std::cout << reflect::get_name_v<first_m> << std::endl; // prints "first"
 
+  std::cout << reflect::enum_to_string(E::second) << std::endl; // "second"
+  if (auto e = reflect::enum_from_string<E>("first")) {
+    std::cout << "parsed " << reflect::enum_to_string(*e) << std::endl;
+  }
+
   return 0;
 }
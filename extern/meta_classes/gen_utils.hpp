@@ -4,6 +4,12 @@
 #include <algorithm>
 #include <iostream>
 #include <iterator>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
 
 #include <std_ast.hpp>
 #include <std_helpers.hpp>
@@ -57,13 +63,16 @@ auto gen_target_output(rules::ast::Target& t, Iter begin, Iter end) {
   return out;
 }
 
+/**
+ * Generate the registration of the meta class functions
+ * in the meta process, whose main is in meta_main.cpp
+ */
 template <class Container>
-std::string gen_main(Container& meta_classes) {
+std::string gen_registration(Container& meta_classes) {
   std::string out;
   out.reserve(100);
-  out +=
-      "static const std::unordered_map<std::string, void(*)(meta::type,const "
-      "meta::type)> funs {\n";
+  out += "\nstatic const bool meta_functions_registered = "
+         "meta::register_functions({\n";
   for (auto& meta_class : meta_classes) {
     out += "{\"";
     out += meta_class;
@@ -72,55 +81,11 @@ std::string gen_main(Container& meta_classes) {
     out += "},";
   }
 
-  out.pop_back();
-  out += "};";
-
-  out += R"main(
-#ifdef _WIN32
-#include <fcntl.h>
-#include <io.h>
-#endif
-int main(int argc, char* argv[]) {
-#ifdef _WIN32
-  _setmode( _fileno( stdout ),  _O_BINARY );
-#endif
-  int mode;
-  while (true) {
-    std::cin >> mode;
-    switch (mode) {
-      case 1: {
-        std::cout << funs.size() << std::endl;
-        for (auto& kv : funs) {
-          std::cout << kv.first << '\n';
-        }
-        break;
-      }
-      case 2: {
-        std::string fun;
-        std::cin >> fun;
-        std::string output;
-        {
-          auto const type = meta::read_type();
-          meta::type t{type.name()};
-          auto f = funs.at(fun);
-          f(t, type);
-          output = t.get_representation();
-        }
-        std::cout << 0 << '\n';
-        std::cout << output.size() << '\n';
-        std::cout << output << std::endl;
-        break;
-      }
-      case 3:
-        return 0;
-      default:
-        std::cout << "unknown mode " << mode;
-    }
+  if (!meta_classes.empty()) {
+    out.pop_back();
   }
+  out += "});\n";
 
-  return 0;
-}
-)main";
   return out;
 }
 
@@ -446,13 +411,258 @@ void write_class(std_parser::rules::ast::Class& cls, Writer& writer) {
   }
 }
 
+/**
+ * Read a string written as its size on one line followed by its content
+ */
+template <typename Reader>
+std::string read_sized(Reader& reader) {
+  std::size_t size;
+  reader >> size;
+  reader.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+  std::string out(size, '\0');
+  reader.read(out.data(), size);
+  return out;
+}
+
+template <typename Writer>
+void write_sized(std::string_view str, Writer& writer) {
+  writer << str.size() << '\n';
+  writer << str << '\n';
+}
+
+template <typename Reader>
+std_parser::rules::ast::SourceLocation read_location(Reader& reader) {
+  std_parser::rules::ast::SourceLocation loc;
+  reader >> loc.row >> loc.col;
+  return loc;
+}
+
+template <typename Reader>
+std::vector<std_parser::rules::ast::TypeQualifier> read_qualifiers(
+    Reader& reader) {
+  std::size_t n;
+  reader >> n;
+  std::vector<std_parser::rules::ast::TypeQualifier> qualifiers;
+  qualifiers.reserve(n);
+  while (n-- > 0) {
+    int q;
+    reader >> q;
+    qualifiers.push_back(static_cast<std_parser::rules::ast::TypeQualifier>(q));
+  }
+  return qualifiers;
+}
+
+/**
+ * The meta side only knows the type as a string, so it is kept as a single
+ * name which gives back the same string from to_string
+ */
+std_parser::rules::ast::UnqulifiedType make_unqualified_type(std::string name) {
+  std_parser::rules::ast::unqulified_type type;
+  type.name.push_back(std::move(name));
+  return {{std::move(type)}};
+}
+
+template <typename Reader>
+std_parser::rules::ast::Type read_type(Reader& reader) {
+  std_parser::rules::ast::Type type;
+  type.left_qualifiers = read_qualifiers(reader);
+
+  bool empty;
+  reader >> empty;
+  if (!empty) {
+    std::string name;
+    reader >> name;
+    type.type = make_unqualified_type(std::move(name));
+  }
+
+  type.right_qualifiers = read_qualifiers(reader);
+  return type;
+}
+
+template <typename Reader>
+std_parser::rules::ast::Function read_function(Reader& reader,
+                                               AccessModifier& modifier) {
+  using namespace std_parser::rules::ast;
+  Function fun;
+  fun.loc = read_location(reader);
+  fun.return_type = read_type(reader);
+  reader >> fun.is_virtual;
+
+  int a;
+  reader >> a;
+  fun.constructor_type = static_cast<Constructor>(a);
+  reader >> a;
+  modifier = static_cast<AccessModifier>(a);
+
+  reader >> fun.name;
+
+  std::size_t num_params;
+  reader >> num_params;
+  while (num_params-- > 0) {
+    var param;
+    param.type = read_type(reader);
+    reader >> param.name;
+    fun.parameters.parameters.push_back(std::move(param));
+  }
+
+  reader >> fun.is_const;
+  reader >> a;
+  fun.qualifier = static_cast<MethodQualifier>(a);
+  reader >> fun.is_noexcept;
+  reader >> fun.is_override;
+  reader >> fun.is_pure_virtual;
+  fun.body = read_sized(reader);
+
+  return fun;
+}
+
+template <typename Reader>
+std_parser::rules::ast::var read_variable(Reader& reader,
+                                          AccessModifier& modifier) {
+  std_parser::rules::ast::var v;
+  v.loc = read_location(reader);
+  v.type = read_type(reader);
+
+  int a;
+  reader >> a;
+  modifier = static_cast<AccessModifier>(a);
+  reader >> v.name;
+
+  // NOTE: the initializer is only needed by the meta classes themselves
+  std::size_t num_exps;
+  reader >> num_exps;
+  while (num_exps-- > 0) {
+    std::string exp;
+    reader >> exp;
+  }
+
+  return v;
+}
+
+/**
+ * Members without an access modifier are public since the meta classes
+ * are generated as structs
+ */
+AccessModifier specified_or_public(AccessModifier modifier) {
+  return modifier == AccessModifier::UNSPECIFIED ? AccessModifier::PUBLIC
+                                                 : modifier;
+}
+
+/**
+ * Rebuild the class from the model written by meta::type::get_model
+ */
+template <typename Reader>
+std_parser::rules::ast::Class read_class(Reader& reader) {
+  using namespace std_parser::rules::ast;
+  class_or_struct cs;
+  cs.type = class_type::STRUCT;
+  reader >> cs.name;
+
+  bool has_template_params;
+  reader >> has_template_params;
+  if (has_template_params) {
+    cs.template_parameters.emplace();
+    std::size_t n;
+    reader >> n;
+    while (n-- > 0) {
+      TemplateParameter param;
+      std::string type;
+      reader >> type >> param.name;
+      param.type.push_back(std::move(type));
+      param.is_variadic = false;
+      cs.template_parameters->push_back(std::move(param));
+    }
+  }
+
+  std::size_t n;
+  reader >> n;
+  while (n-- > 0) {
+    std::string arg;
+    reader >> arg;
+    Type type;
+    type.type = make_unqualified_type(std::move(arg));
+    cs.specialization.template_types.emplace_back(std::move(type));
+  }
+
+  Class cls{std::move(cs)};
+
+  AccessModifier modifier;
+  reader >> n;
+  while (n-- > 0) {
+    auto fun = read_function(reader, modifier);
+    cls.set_access_modifier(specified_or_public(modifier));
+    cls.add_function(std::move(fun));
+  }
+
+  reader >> n;
+  while (n-- > 0) {
+    auto v = read_variable(reader, modifier);
+    cls.set_access_modifier(specified_or_public(modifier));
+    cls.add_variable(std::move(v));
+  }
+
+  reader >> n;
+  while (n-- > 0) {
+    std::string name;
+    int a;
+    reader >> name >> a;
+    auto base = make_unqualified_type(std::move(name));
+    switch (specified_or_public(static_cast<AccessModifier>(a))) {
+      case AccessModifier::PROTECTED:
+        cls.protected_bases.push_back(std::move(base));
+        break;
+      case AccessModifier::PRIVATE:
+        cls.private_bases.push_back(std::move(base));
+        break;
+      default:
+        cls.public_bases.push_back(std::move(base));
+        break;
+    }
+  }
+
+  reader >> n;
+  while (n-- > 0) {
+    cls.add_class(read_class(reader));
+  }
+
+  cls.set_access_modifier(AccessModifier::PUBLIC);
+  return cls;
+}
+
+/**
+ * The generated class as source code and as the model it was generated from
+ */
+struct GeneratedClass {
+  std::string output;
+  std::string model;
+
+  std_parser::rules::ast::Class get_class() const {
+    std::istringstream in(model);
+    return read_class(in);
+  }
+};
+
+template <typename Reader>
+GeneratedClass read_generated_class(Reader& reader) {
+  auto output = read_sized(reader);
+  auto model = read_sized(reader);
+  return {std::move(output), std::move(model)};
+}
+
+template <typename Writer>
+void write_generated_class(GeneratedClass const& generated, Writer& writer) {
+  write_sized(generated.output, writer);
+  write_sized(generated.model, writer);
+}
+
 enum class ParsedResult { OK, Error };
 
 template <class StdParser, class ErrorReporter>
 void handle_meta_process_request(MetaProcess& process, StdParser& std_parser,
                                  std::string_view request,
-                                 ErrorReporter& reporter) {
-  std::cout << "Recieved request: " << request;
+                                 ErrorReporter& reporter,
+                                 std::ostream& log = std::cout) {
+  log << "Recieved request: " << request;
   auto out = std_parser.try_parse_entire_class(request.begin(), request.end());
   if (out.result) {
     process.output << static_cast<int>(ParsedResult::OK) << std::endl;
@@ -465,12 +675,20 @@ void handle_meta_process_request(MetaProcess& process, StdParser& std_parser,
     msg += std::string_view{&*out.processed_to, size};
     reporter(msg);
 
-    std::exit(EXIT_FAILURE);
+    // NOTE: the meta process is left waiting in the middle of the request,
+    // the caller drops it
+    throw std::runtime_error(msg);
   }
 }
 
+/**
+ * Send the class to the meta process for the meta_class to be applied to it
+ *
+ * Returns the generated class' source together with it's model,
+ * handling any parse requests the meta process makes meanwhile
+ */
 template <typename StdParser, class ErrorReporter>
-std::string gen_meta_class(MetaProcess& process,
+GeneratedClass gen_meta_class(MetaProcess& process,
                            const std::string_view meta_class,
                            std_parser::rules::ast::Class& cls,
                            StdParser& std_parser, ErrorReporter& reporter) {
@@ -497,8 +715,7 @@ std::string gen_meta_class(MetaProcess& process,
     switch (status) {
       case -1: {
         reporter(output);
-        // TODO: throw exception and catch in main to guarantee resource cleanup
-        std::exit(EXIT_FAILURE);
+        throw std::runtime_error("meta class error: " + output);
       }
       case 1: {
         handle_meta_process_request(process, std_parser, output, reporter);
@@ -506,7 +723,98 @@ std::string gen_meta_class(MetaProcess& process,
     }
   } while (status != 0);
 
-  return output;
+  auto model = read_sized(process.input);
+  return {std::move(output), std::move(model)};
+}
+
+/**
+ * A meta class to be applied on a class, part of a batch request
+ */
+struct MetaClassRequest {
+  std::string meta_class;
+  std_parser::rules::ast::Class cls;
+};
+
+/**
+ * Send all of the requests to the meta process in one message
+ *
+ * The meta process asks for the generated bodies of the whole batch to be
+ * parsed at once (status 2), so the number of round trips doesn't grow with
+ * the number of classes. Returns the generated classes in the order of the
+ * requests.
+ *
+ * NOTE: not O(1) per source, MetaClassParser sends a batch every
+ * max_batch_size classes so the meta process works while the source is
+ * parsed, taking ceil(N / max_batch_size) round trips for N classes.
+ * The bodies generated by meta functions called from the meta function of a
+ * class are still parsed one at a time (status 1) when they return, so a
+ * composed meta function sees the members the earlier ones generated.
+ *
+ * NOTE: can be called off the parsing thread, so the progress is written to
+ * log instead of std::cout
+ */
+template <typename StdParser, class ErrorReporter>
+std::vector<GeneratedClass> gen_meta_classes(
+    MetaProcess& process, std::vector<MetaClassRequest>& requests,
+    StdParser& std_parser, ErrorReporter& reporter, std::ostream& log) {
+  log << "getting output from meta process for " << requests.size()
+      << " metaclasses\n";
+  process.output << 4 << '\n';
+  process.output << requests.size() << '\n';
+  for (auto& request : requests) {
+    process.output << request.meta_class << '\n';
+    write_class(request.cls, process.output);
+  }
+  process.output.flush();
+
+  int status;
+  while (process.input >> status && status != 0) {
+    switch (status) {
+      case -1: {
+        auto error = read_sized(process.input);
+        reporter(error);
+        // NOTE: thrown to the outputs waiting on the batch
+        throw std::runtime_error("meta class error: " + error);
+      }
+      case 1: {
+        auto request = read_sized(process.input);
+        handle_meta_process_request(process, std_parser, request, reporter,
+                                    log);
+        break;
+      }
+      case 2: {
+        std::size_t n;
+        process.input >> n;
+        // NOTE: read all of them before answering so neither side blocks
+        // on a full pipe while the other one is still writing
+        std::vector<std::string> parse_requests;
+        parse_requests.reserve(n);
+        while (n-- > 0) {
+          parse_requests.push_back(read_sized(process.input));
+        }
+        for (auto& request : parse_requests) {
+          handle_meta_process_request(process, std_parser, request, reporter,
+                                      log);
+        }
+        break;
+      }
+      default:
+        throw std::runtime_error("unknown meta process status " +
+                                 std::to_string(status));
+    }
+  }
+
+  std::size_t n = 0;
+  if (!(process.input >> n)) {
+    throw std::runtime_error("the meta process stopped responding");
+  }
+  std::vector<GeneratedClass> generated;
+  generated.reserve(n);
+  while (n-- > 0) {
+    generated.push_back(read_generated_class(process.input));
+  }
+
+  return generated;
 }
 }  // namespace meta_classes
 
@@ -0,0 +1,205 @@
+#ifndef META_CACHE_H
+#define META_CACHE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace meta_classes {
+
+/**
+ * 64 bit FNV-1a, unlike std::hash it is stable between runs and compilers
+ * so it can be used to name files in the on disk cache
+ */
+constexpr std::uint64_t fnv1a(std::string_view str,
+                              std::uint64_t hash = 14695981039346656037ull) {
+  for (auto c : str) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+std::string to_hex(std::uint64_t value) {
+  constexpr char digits[] = "0123456789abcdef";
+  std::string out(16, '0');
+  for (auto it = out.rbegin(); it != out.rend(); ++it) {
+    *it = digits[value & 0xf];
+    value >>= 4;
+  }
+  return out;
+}
+
+/**
+ * Hash the content of a file, empty hash if it can't be opened
+ */
+std::uint64_t hash_file(fs::path const& path) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in.is_open()) {
+    return fnv1a("");
+  }
+
+  std::string content((std::istreambuf_iterator<char>(in)),
+                      std::istreambuf_iterator<char>());
+  return fnv1a(content);
+}
+
+/**
+ * Suffix of the temporaries unique to the process and the thread
+ */
+std::string temp_suffix() {
+  std::string suffix;
+#if defined(__unix__) || defined(__APPLE__)
+  suffix += std::to_string(getpid()) + '.';
+#endif
+  return suffix + std::to_string(
+                      std::hash<std::thread::id>{}(std::this_thread::get_id()));
+}
+
+/**
+ * Content addressed cache of meta class expansions
+ *
+ * The key is made of the meta executable's hash, the meta class name
+ * and the serialized class it is applied to, so a change in any of them
+ * will miss. Results are always kept in memory and if a cache directory
+ * is given also written to disk to be reused by other processes and builds.
+ *
+ * Lookups and stores can be done from different threads.
+ */
+class MetaCache {
+  std::mutex mutex;
+  std::unordered_map<std::string, std::string> cache;
+  std::uint64_t meta_exe_hash = 0;
+  fs::path cache_dir;
+
+  std::size_t hits = 0;
+  std::size_t misses = 0;
+
+  std::optional<std::string> load(std::string const& key) {
+    if (cache_dir.empty()) {
+      return std::nullopt;
+    }
+
+    std::ifstream in(cache_dir / key, std::ios::binary);
+    if (!in.is_open()) {
+      return std::nullopt;
+    }
+
+    return std::string((std::istreambuf_iterator<char>(in)),
+                       std::istreambuf_iterator<char>());
+  }
+
+  void save(std::string const& key, std::string const& output) {
+    if (cache_dir.empty()) {
+      return;
+    }
+
+    std::error_code e;
+    fs::create_directories(cache_dir, e);
+    // NOTE: write to a temporary and rename so a concurrent reader never
+    // sees a partially written entry, per process and thread as concurrent
+    // jobs of the build can store the same key
+    auto tmp = cache_dir / (key + ".tmp" + temp_suffix());
+    {
+      std::ofstream out(tmp, std::ios::binary);
+      out << output;
+      if (!out) {
+        return;
+      }
+    }
+    fs::rename(tmp, cache_dir / key, e);
+  }
+
+ public:
+  MetaCache() = default;
+
+  MetaCache(fs::path const& meta_exe, fs::path cache_dir)
+      : meta_exe_hash{hash_file(meta_exe)}, cache_dir{std::move(cache_dir)} {}
+
+  // NOTE: the mutex can't be moved, so only the content is
+  MetaCache(MetaCache&& c)
+      : cache{std::move(c.cache)},
+        meta_exe_hash{c.meta_exe_hash},
+        cache_dir{std::move(c.cache_dir)},
+        hits{c.hits},
+        misses{c.misses} {}
+
+  MetaCache& operator=(MetaCache&& c) {
+    cache = std::move(c.cache);
+    meta_exe_hash = c.meta_exe_hash;
+    cache_dir = std::move(c.cache_dir);
+    hits = c.hits;
+    misses = c.misses;
+
+    return *this;
+  }
+
+  /**
+   * Make the key for the meta class applied on the serialized class
+   */
+  std::string make_key(std::string_view meta_class,
+                       std::string_view serialized_class) const {
+    auto hash = fnv1a(meta_class);
+    hash = fnv1a("\n", hash);
+    hash = fnv1a(serialized_class, hash);
+    return to_hex(meta_exe_hash) + to_hex(hash);
+  }
+
+  /**
+   * Return the cached output for the key, first from memory then from disk
+   */
+  std::optional<std::string> find(std::string const& key) {
+    std::lock_guard lock{mutex};
+    if (auto it = cache.find(key); it != cache.end()) {
+      ++hits;
+      return it->second;
+    }
+
+    if (auto out = load(key); out) {
+      ++hits;
+      cache.emplace(key, *out);
+      return out;
+    }
+
+    ++misses;
+    return std::nullopt;
+  }
+
+  void store(std::string const& key, std::string const& output) {
+    std::lock_guard lock{mutex};
+    save(key, output);
+    cache.insert_or_assign(key, output);
+  }
+
+  auto get_hits() const { return hits; }
+
+  auto get_misses() const { return misses; }
+
+  template <typename Writer>
+  void report(Writer& writer) const {
+    auto lookups = hits + misses;
+    if (lookups == 0) {
+      return;
+    }
+
+    writer << "meta cache: " << hits << " hits, " << misses << " misses ("
+           << (hits * 100 / lookups) << "% hit rate)" << std::endl;
+  }
+};
+}  // namespace meta_classes
+
+#endif  //! META_CACHE_H
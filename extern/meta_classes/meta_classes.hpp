@@ -2,11 +2,20 @@
 #define META_CLASSES_H
 
 #include <algorithm>
+#include <chrono>
+#include <deque>
+#include <exception>
+#include <future>
 #include <iostream>
 #include <iterator>
+#include <memory>
+#include <sstream>
 #include <unordered_set>
 #include <variant>
+#include <vector>
 
+#include <alloc_stats.hpp>
+#include <jobserver.hpp>
 #include <overloaded.hpp>
 #include <result.hpp>
 #include <source_loader.hpp>
@@ -14,8 +23,11 @@
 #include <string_utils.hpp>
 
 #include <gen_utils.hpp>
+#include <meta_cache.hpp>
 #include <meta_classes_rules.hpp>
+#include <meta_pool.hpp>
 #include <meta_process.hpp>
+#include <meta_worker.hpp>
 
 #include <boost/process.hpp>
 
@@ -102,9 +114,12 @@ class MetaClassParser {
         meta_classes.emplace(fun.name);
         inside_meta_class_function = true;
         std::string res = {source.begin(), out->processed_to};
+        // NOTE: inline since the meta output of all sources is linked
+        // into one meta process and headers can be included by many
         const std::string c = "constexpr";
+        const std::string i = "inline";
         auto it = std::search(res.begin(), res.end(), c.begin(), c.end());
-        res.erase(it, it + c.size());
+        res.replace(it, it + c.size(), i);
 
         writer(res);
         using Fun = std_parser::rules::ast::Function;
@@ -292,6 +307,169 @@ class MetaClassParser {
         });
   }
 
+  /**
+   * Append the reflection of the generated class to it's output
+   * if we are also generating static reflection
+   */
+  std::string finish_meta_class(GeneratedClass generated) {
+    auto output = std::move(generated.output);
+    std::cout << output;
+    constexpr int static_id = 5;
+    if constexpr (Parent::template has_parser_with_id<static_id>()) {
+      // NOTE: the meta process sends the model of the generated class
+      // so we don't need to parse the output again
+      auto cls = generated.get_class();
+      auto& static_refl = parent.template get_parser<static_id>();
+      auto refl_out = static_refl.generate_reflection(cls);
+      std::cout << refl_out;
+      std::string scope_end = ";}";
+      auto it = std::search(output.rbegin(), output.rend(), scope_end.begin(), scope_end.end());
+      if (it != output.rend()) {
+        auto dist = std::distance(output.rbegin(), it) + scope_end.size();
+        output.erase(output.end() - dist, output.end());
+        output += refl_out;
+      }
+    }
+
+    return output;
+  }
+
+  /**
+   * Get the meta class output for the class from the cache, or add it to the
+   * batch to be generated by the meta process and cached
+   *
+   * Returns the output if it was cached, else the output is deferred until
+   * the meta process generates the batch, so we can continue parsing meanwhile
+   *
+   * A full batch is sent right away so the meta process works on it while
+   * the rest of the source is parsed
+   */
+  std::optional<std::string> expand_meta_class(std_ast::Class&& cls) {
+    std::ostringstream serialized_class;
+    write_class(cls, serialized_class);
+    auto key = meta_cache.make_key(current_meta_class, serialized_class.str());
+    if (auto cached = meta_cache.find(key); cached) {
+      std::istringstream in(*cached);
+      return finish_meta_class(read_generated_class(in));
+    }
+
+    auto& pending = batch.emplace_back(PendingMetaClass{
+        {current_meta_class, std::move(cls)}, std::move(key), {}});
+    parent.defer_output(pending.output.get_future());
+    if (batch.size() >= max_batch_size) {
+      send_batch();
+    }
+    return std::nullopt;
+  }
+
+  /**
+   * Send the meta classes collected from the source since the last batch
+   * to the meta process in one request
+   *
+   * NOTE: the worker only talks to the meta process, the generated classes
+   * are finished on the parsing thread by finish_batches since the static
+   * reflection and the output are not shared with the worker
+   */
+  void send_batch() {
+    if (batch.empty()) {
+      return;
+    }
+
+    auto& std_parser = parent.template get_parser<Parent::std_parser_id>();
+    std::promise<BatchOutput> output;
+    auto& sent = sent_batches.emplace_back(SentBatch{
+        parent.get_current_file_name(), std::move(batch), output.get_future()});
+    std::vector<MetaClassRequest> requests;
+    requests.reserve(sent.classes.size());
+    for (auto& pending : sent.classes) {
+      requests.push_back(std::move(pending.request));
+    }
+    std::vector<std::string> keys;
+    keys.reserve(sent.classes.size());
+    for (auto& pending : sent.classes) {
+      keys.push_back(pending.key);
+    }
+
+    auto task = [this, &std_parser, output = std::move(output),
+                 requests = std::move(requests),
+                 keys = std::move(keys)]() mutable {
+      BatchOutput out;
+      std::ostringstream log;
+      auto error_reporter = [&out](std::string_view msg) {
+        out.errors.emplace_back(msg);
+      };
+
+      // NOTE: counted on the worker thread, with the caching of the outputs
+      ALLOC_STATS_SCOPE("MetaClassParser meta round trip");
+      try {
+        out.generated = gen_meta_classes(meta_process, requests, std_parser,
+                                         error_reporter, log);
+        if (out.generated.size() != requests.size()) {
+          throw std::runtime_error(
+              "the meta process generated " +
+              std::to_string(out.generated.size()) + " of the " +
+              std::to_string(requests.size()) + " meta classes");
+        }
+        for (std::size_t i = 0; i < keys.size(); ++i) {
+          std::ostringstream generated;
+          write_generated_class(out.generated[i], generated);
+          meta_cache.store(keys[i], generated.str());
+        }
+      } catch (...) {
+        // NOTE: the meta process is in an unknown state so it isn't used
+        // again, the error is thrown where the outputs are waited on
+        out.error = std::current_exception();
+      }
+      out.log = log.str();
+      output.set_value(std::move(out));
+    };
+
+    batch.clear();
+    if (meta_worker) {
+      meta_worker->push(std::move(task));
+    } else {
+      task();
+    }
+  }
+
+  /**
+   * Give the outputs of the batches the meta process is done with to the
+   * ones waiting on them, or wait for all of them if wait_all is set
+   */
+  void finish_batches(bool wait_all) {
+    while (!sent_batches.empty()) {
+      auto& sent = sent_batches.front();
+      if (!wait_all && sent.output.wait_for(std::chrono::seconds(0)) !=
+                           std::future_status::ready) {
+        return;
+      }
+
+      auto out = sent.output.get();
+      std::cout << out.log;
+      auto& reporter = parent.get_reporter();
+      for (auto& error : out.errors) {
+        reporter(sent.file_name, error);
+      }
+      std::size_t finished = 0;
+      try {
+        if (out.error) {
+          std::rethrow_exception(out.error);
+        }
+        for (; finished < sent.classes.size(); ++finished) {
+          sent.classes[finished].output.set_value(
+              finish_meta_class(std::move(out.generated[finished])));
+        }
+      } catch (...) {
+        failed = failed || out.error;
+        for (; finished < sent.classes.size(); ++finished) {
+          sent.classes[finished].output.set_exception(
+              std::current_exception());
+        }
+      }
+      sent_batches.pop_front();
+    }
+  }
+
   template <class Source>
   auto parse_inside_meta_class(Source& source) {
     auto& std_parser = parent.template get_parser<Parent::std_parser_id>();
@@ -301,43 +479,23 @@ class MetaClassParser {
     namespace x3 = boost::spirit::x3;
     bool parsed = x3::parse(begin, end, rules::scope_end);
 
-    std::string output;
+    std::optional<std_ast::Class> meta_class;
     using Class = std_parser::rules::ast::Class;
     // TODO: check if this will get triggered if a method ends with };
     if (parsed && meta_process.ok()) {
       auto& current_code_fragment = std_parser.get_current_code_fragment();
-      auto& cls = std::get<Class>(current_code_fragment);
-      auto& reporter = parent.get_reporter();
-      auto const& file_name = parent.get_current_file_name();
-      auto error_reporter = [&reporter, &file_name](std::string_view msg) {
-        reporter(file_name, msg);
-      };
-      output = gen_meta_class(meta_process, current_meta_class, cls, std_parser,
-                              error_reporter);
+      meta_class = std::get<Class>(current_code_fragment);
     }
 
     auto out = std_parser.parse(source);
     if (out) {
       if (not is_still_inside_meta_class()) {
+        std::string output;
+        if (meta_class) {
+          output = expand_meta_class(std::move(*meta_class)).value_or("");
+        }
         current_meta_class.clear();
         current_meta_class_name.clear();
-        auto cls_out = std_parser.try_parse_entire_class(output.begin(), output.end());
-        if (cls_out.result) {
-          std::cout << output;
-          constexpr int static_id = 5;
-          if constexpr (Parent::template has_parser_with_id<static_id>()) {
-            auto& static_refl = parent.template get_parser<static_id>();
-            auto refl_out = static_refl.generate_reflection(*cls_out.result);
-            std::cout << refl_out;
-            std::string scope_end = ";}";
-            auto it = std::search(output.rbegin(), output.rend(), scope_end.begin(), scope_end.end());
-            if (it != output.rend()) {
-              auto dist = std::distance(output.rbegin(), it) + scope_end.size();
-              output.erase(output.end() - dist, output.end());
-              output += refl_out;
-            }
-          }
-        }
 
         return std::optional{Result{out->processed_to, output}};
       }
@@ -347,35 +505,104 @@ class MetaClassParser {
     return make_result(out);
   }
 
+  /**
+   * A meta class waiting to be sent to the meta process
+   */
+  struct PendingMetaClass {
+    MetaClassRequest request;
+    std::string key;
+    std::promise<std::string> output;
+  };
+
+  /**
+   * What the worker got from the meta process for a batch, with the progress
+   * and the errors to be written by the parsing thread
+   */
+  struct BatchOutput {
+    std::vector<GeneratedClass> generated;
+    std::string log;
+    std::vector<std::string> errors;
+    std::exception_ptr error;
+  };
+
+  /**
+   * A batch sent to the meta process whose classes are not finished yet
+   */
+  struct SentBatch {
+    std::string file_name;
+    std::vector<PendingMetaClass> classes;
+    std::future<BatchOutput> output;
+  };
+
   Parent& parent;
 
   std::string meta_exe;
+  std::string meta_cache_dir;
+  std::optional<fs::file_time_type> meta_exe_time;
   std::unordered_set<std::string> meta_classes;
   bool inside_meta_class_function = false;
   std::string current_meta_class;
   std::string current_meta_class_name;
-  std::ofstream out_file;
+  std::ostringstream out_file;
+  fs::path out_path;
   source::SourceLoader source_loader;
   MetaProcess meta_process;
+  MetaCache meta_cache;
+  std::vector<PendingMetaClass> batch;
+  std::deque<SentBatch> sent_batches;
+  // NOTE: fewer meta classes per batch overlap more of the meta process'
+  // work with the parsing, more of them take fewer round trips
+  constexpr static std::size_t max_batch_size = 8;
+  // the job slot of the meta worker, released after the worker is done
+  std::optional<jobserver::Token> meta_worker_token;
+  std::unique_ptr<MetaWorker> meta_worker;
+  // set by a failed request
+  bool failed = false;
   bool is_source = false;
 
  public:
   // TODO: when supported in std=c++2a change to fixed length string
   constexpr static int id = 7;
 
+  /**
+   * meta_cache_dir is optional, if given the generated meta classes will also
+   * be cached on disk and reused between runs
+   */
   MetaClassParser(Parent& p, std::string_view meta_exe,
-                  std::string_view meta_out)
-      : parent{p}, meta_exe{meta_exe}, source_loader{{}, meta_out} {
+                  std::string_view meta_out,
+                  std::string_view meta_cache_dir = "")
+      : parent{p},
+        meta_exe{meta_exe},
+        meta_cache_dir{meta_cache_dir},
+        source_loader{{}, meta_out} {
     if (!this->meta_exe.empty()) {
-      meta_process = MetaProcess(this->meta_exe);
-      auto& p1 = meta_process.output;
-      auto& p2 = meta_process.input;
-      p1 << '1' << std::endl;
-      std::string out;
-      int n;
-      p2 >> n;
-      while (n-- && p2 >> out) {
-        meta_classes.emplace(std::move(out));
+      // a resident preprocessor reuses the meta process of its last run
+      if (auto warm = MetaPool::take(this->meta_exe, this->meta_cache_dir)) {
+        meta_exe_time = warm->exe_time;
+        meta_process = std::move(warm->process);
+        meta_classes = std::move(warm->meta_classes);
+        meta_cache = std::move(warm->cache);
+      } else {
+        meta_exe_time = MetaPool::exe_time(this->meta_exe);
+        meta_cache = MetaCache(this->meta_exe, meta_cache_dir);
+        meta_process = MetaProcess(this->meta_exe);
+        auto& p1 = meta_process.output;
+        auto& p2 = meta_process.input;
+        p1 << '1' << std::endl;
+        std::string out;
+        int n;
+        p2 >> n;
+        while (n-- && p2 >> out) {
+          meta_classes.emplace(std::move(out));
+        }
+      }
+      // NOTE: from here on only the worker talks to the meta process
+      // the meta process keeps running next to the parsing in a slot of its
+      // own, without a free slot of the build the meta classes are expanded
+      // on the parsing thread instead
+      meta_worker_token = jobserver::Client::get().try_acquire();
+      if (meta_worker_token) {
+        meta_worker = std::make_unique<MetaWorker>();
       }
     }
   }
@@ -384,13 +611,43 @@ class MetaClassParser {
 
   ~MetaClassParser() noexcept {
     if (!this->meta_exe.empty()) {
+      // wait for any unfinished meta class requests
+      meta_worker.reset();
+      meta_worker_token.reset();
+      // NOTE: only left when the parsing failed, their outputs aren't used
+      for (auto& sent : sent_batches) {
+        failed = failed || !sent.output.valid() || sent.output.get().error;
+      }
+      meta_cache.report(std::cout);
+      if (failed) {
+        meta_process.terminate();
+        return;
+      }
+      // NOTE: a resident preprocessor keeps the meta process for its next run
+      if (MetaPool::is_enabled() && meta_exe_time && meta_process.ok() &&
+          MetaPool::give(meta_exe, meta_cache_dir,
+                         WarmMeta{*meta_exe_time, std::move(meta_process),
+                                  std::move(meta_classes),
+                                  std::move(meta_cache)})) {
+        return;
+      }
       meta_process.output << 3 << std::endl;
       meta_process.wait();
     }
   }
 
+  /**
+   * The whole source is parsed, send the meta classes found in it and
+   * finish all of the generated classes before the outputs are waited on
+   */
+  void finish_process() {
+    send_batch();
+    finish_batches(true);
+  }
+
   void start_preprocess(std::string_view source_name) {
-    out_file = source_loader.open_source(source_name);
+    out_path = source_loader.get_out_path(source_name);
+    out_file.str("");
     out_file << "#include <meta.hpp>" << std::endl;
     is_source = source::is_source(source_name);
   }
@@ -421,11 +678,15 @@ class MetaClassParser {
     return meta ? meta : parse_include(source, writer);
   }
 
+  /**
+   * Write the meta output only if it changed, so the meta process
+   * is rebuilt only when a meta class definition changes
+   */
   void finish_preprocess() {
     if (is_source) {
-      out_file << gen_main(meta_classes);
+      out_file << gen_registration(meta_classes);
     }
-    out_file.close();
+    source::write_if_changed(out_path, out_file.str());
   }
 
   /**
@@ -433,6 +694,7 @@ class MetaClassParser {
    */
   template <class Source>
   RetType<Source> parse(Source& source) {
+    finish_batches(false);
     // TODO: fix this
     auto writer = [](auto&) {};
     if (inside_meta_class_function) {
@@ -3,8 +3,13 @@
 
 #include <algorithm>
 #include <cstddef>
+#include <cstdint>
+#include <initializer_list>
 #include <iostream>
+#include <iterator>
 #include <memory>
+#include <optional>
+#include <sstream>
 #include <string>
 #include <string_view>
 #include <unordered_map>
@@ -55,7 +60,7 @@ enum class Access { PUBLIC, PROTECTED, PRIVATE, UNSPECIFIED };
 
 enum class TypeQualifier { Inline, Static, Const, Constexpr, L_Ref, R_Ref, Pointer };
 
-std::string to_string(TypeQualifier q) {
+inline std::string to_string(TypeQualifier q) {
   switch (q) {
     case TypeQualifier::Const:
       return "const";
@@ -76,7 +81,7 @@ std::string to_string(TypeQualifier q) {
   return "";
 }
 
-std::string to_string(Access a) {
+inline std::string to_string(Access a) {
   switch (a) {
     case Access::PUBLIC:
       return "public: ";
@@ -472,15 +477,21 @@ struct Type {
     return content;
   }
 };
-void finalize(meta::type& target);
-Type read_type();
+inline void finalize(meta::type& target);
+inline Type read_type();
+inline std::string write_type(Type const& t);
 }  // namespace detail
 
-type read_type();
+inline type read_type();
+inline void parse_bodies(std::vector<type*> const& types);
 
 class type {
   const std::string class_name;
   std::shared_ptr<detail::Type> internal;
+  // the target of a batch, it's body is parsed by parse_bodies
+  bool batch_target = false;
+  // the copy given to the meta function of a batch target
+  bool deferred = false;
 
  public:
   type(detail::Type&& type)
@@ -491,9 +502,31 @@ class type {
       : class_name{name},
         internal{std::make_shared<detail::Type>(name)} {}
 
+  // NOTE: only the copy given to the meta function of the batch defers, the
+  // copies given to the meta functions it calls are still parsed when they
+  // are destroyed, so it sees what they generated
+  type(type const& t)
+      : class_name{t.class_name},
+        internal{t.internal},
+        deferred{t.batch_target} {}
+
   ~type() {
-    // NOTE: if there is any generated ( -> ) based content
-    // send it for parsing and update our internal state
+    if (!batch_target && !deferred) {
+      parse_body();
+    }
+  }
+
+  /**
+   * Make the type the target of a batch, so the body it's meta function
+   * generates is parsed together with the others by parse_bodies
+   */
+  void defer_parsing() { batch_target = true; }
+
+  /**
+   * If there is any generated ( -> ) based content
+   * send it for parsing and update our internal state
+   */
+  void parse_body() {
     if (!internal->body.empty()) {
       enum class ParsedResult { OK, Error };
       std::cout << 1 << std::endl;
@@ -512,6 +545,8 @@ class type {
     }
   }
 
+  friend void parse_bodies(std::vector<type*> const& types);
+
   auto const& name() const { return class_name; }
 
   auto const& functions() const { return internal->methods; }
@@ -580,16 +615,25 @@ class type {
     detail::finalize(*this);
     return internal->to_string();
   }
+
+  /**
+   * The generated class serialized in the same format it was received in,
+   * so the preprocessor can rebuild it without parsing the representation
+   */
+  std::string get_model() {
+    parse_body();
+    return detail::write_type(*internal);
+  }
 };
 
 namespace detail {
-SourceLocation read_loc() {
+inline SourceLocation read_loc() {
   uint16_t row, col;
   std::cin >> row >> col;
   return {row, col};
 }
 
-CppType read_cpp_type() {
+inline CppType read_cpp_type() {
   std::size_t n;
   std::cin >> n;
   std::vector<TypeQualifier> left_qualifiers;
@@ -618,7 +662,7 @@ CppType read_cpp_type() {
           std::move(right_qualifiers)};
 }
 
-Param read_parameter() {
+inline Param read_parameter() {
   std::string name;
   auto type = read_cpp_type();
   std::cin >> name;
@@ -626,7 +670,7 @@ Param read_parameter() {
   return {std::move(type), std::move(name)};
 }
 
-Var read_var() {
+inline Var read_var() {
   auto loc = read_loc();
   std::string name;
   auto type = read_cpp_type();
@@ -647,7 +691,7 @@ Var read_var() {
   return {std::move(type), std::move(name), std::move(init), acc, loc};
 }
 
-Function read_function() {
+inline Function read_function() {
   auto loc = read_loc();
   auto return_type = read_cpp_type();
   bool is_virtual;
@@ -705,7 +749,7 @@ Function read_function() {
           body};
 }
 
-Base read_base() {
+inline Base read_base() {
   std::string name;
   std::cin >> name;
   int a;
@@ -715,7 +759,7 @@ Base read_base() {
   return {name, acc};
 }
 
-void finalize(meta::type& target) {
+inline void finalize(meta::type& target) {
   for (auto o : target.variables())
     if (!o.has_access()) o.make_private();
   // make data members private by default
@@ -731,14 +775,14 @@ void finalize(meta::type& target) {
   // make it public nonvirtual by default
 }
 
-TemplateParameter read_template_param() {
+inline TemplateParameter read_template_param() {
   std::string type, name;
 
   std::cin >> type >> name;
   return {std::move(type), std::move(name)};
 }
 
-Type read_type() {
+inline Type read_type() {
   std::string class_name;
   std::cin >> class_name;
 
@@ -800,11 +844,159 @@ Type read_type() {
   return {std::move(class_name), std::move(template_params), std::move(template_specialization), std::move(methods), std::move(variables),
           std::move(bases), std::move(sub_types)};
 }
+
+inline void write_cpp_type(CppType const& t, std::ostream& out) {
+  out << t.left_qualifiers.size() << '\n';
+  for (auto q : t.left_qualifiers) {
+    out << static_cast<int>(q) << '\n';
+  }
+
+  out << t.type.empty() << '\n';
+  if (!t.type.empty()) {
+    out << t.type << '\n';
+  }
+
+  out << t.right_qualifiers.size() << '\n';
+  for (auto q : t.right_qualifiers) {
+    out << static_cast<int>(q) << '\n';
+  }
+}
+
+inline void write_function(Function const& f, std::ostream& out) {
+  out << f.loc.row << '\n' << f.loc.col << '\n';
+  write_cpp_type(f.return_type, out);
+  out << f.is_virtual_ << '\n';
+  out << static_cast<int>(f.constructor_type) << '\n';
+  out << static_cast<int>(f.access) << '\n';
+  out << f.name << '\n';
+
+  out << f.parameters.size() << '\n';
+  for (auto& p : f.parameters) {
+    write_cpp_type(p.type, out);
+    out << p.name << '\n';
+  }
+
+  out << f.is_const << '\n';
+  out << static_cast<int>(f.qualifier) << '\n';
+  out << f.is_noexcept << '\n';
+  out << f.is_override << '\n';
+  out << f.is_pure_virtual << '\n';
+  out << f.body.size() << '\n';
+  out << f.body << '\n';
+}
+
+inline void write_var(Var const& v, std::ostream& out) {
+  out << v.loc.row << '\n' << v.loc.col << '\n';
+  write_cpp_type(v.var_type, out);
+  out << static_cast<int>(v.access) << '\n';
+  out << v.name << '\n';
+  out << v.init.size() << '\n';
+  for (auto& exp : v.init) {
+    out << exp << '\n';
+  }
+}
+
+inline void write_type(Type const& t, std::ostream& out) {
+  out << t.name << '\n';
+
+  out << t.template_params.has_value() << '\n';
+  if (t.template_params) {
+    out << t.template_params->size() << '\n';
+    for (auto& p : *t.template_params) {
+      out << p.type << '\n' << p.name << '\n';
+    }
+  }
+
+  out << t.template_specialization.size() << '\n';
+  for (auto& arg : t.template_specialization) {
+    out << arg << '\n';
+  }
+
+  out << t.methods.size() << '\n';
+  for (auto& m : t.methods) {
+    write_function(m, out);
+  }
+
+  out << t.variables.size() << '\n';
+  for (auto& v : t.variables) {
+    write_var(v, out);
+  }
+
+  out << t.bases.size() << '\n';
+  for (auto& b : t.bases) {
+    out << b.name << '\n' << static_cast<int>(b.access) << '\n';
+  }
+
+  out << t.sub_types.size() << '\n';
+  for (auto& sub_type : t.sub_types) {
+    write_type(sub_type, out);
+  }
+}
+
+inline std::string write_type(Type const& t) {
+  std::ostringstream out;
+  write_type(t, out);
+  return out.str();
+}
 }  // namespace detail
 
-type read_type() {
+inline type read_type() {
   return {detail::read_type()};
 }
+
+/**
+ * Send the bodies of all of the types for parsing in one request
+ * and update them with the result
+ */
+inline void parse_bodies(std::vector<type*> const& types) {
+  std::vector<type*> unparsed;
+  std::copy_if(types.begin(), types.end(), std::back_inserter(unparsed),
+               [](type* t) { return !t->internal->body.empty(); });
+  if (unparsed.empty()) {
+    return;
+  }
+
+  enum class ParsedResult { OK, Error };
+  std::cout << 2 << '\n';
+  std::cout << unparsed.size() << '\n';
+  for (auto* t : unparsed) {
+    auto str = t->internal->to_string();
+    std::cout << str.size() << '\n';
+    std::cout << str << '\n';
+  }
+  std::cout.flush();
+
+  for (auto* t : unparsed) {
+    int out;
+    std::cin >> out;
+    auto result = static_cast<ParsedResult>(out);
+    if (result == ParsedResult::Error) {
+      std::exit(EXIT_FAILURE);
+    }
+
+    *t->internal = detail::read_type();
+  }
+}
+
+using function = void (*)(type, const type);
+
+/**
+ * All of the registered meta class functions by name
+ */
+inline std::unordered_map<std::string, function>& functions() {
+  static std::unordered_map<std::string, function> funs;
+  return funs;
+}
+
+/**
+ * Register meta class functions, used by the generated meta sources
+ * to make them visible to the meta process' main
+ */
+inline bool register_functions(
+    std::initializer_list<std::pair<const std::string, function>> funs) {
+  functions().insert(funs);
+  return true;
+}
 }  // namespace meta
 
 #endif  // META_H
@@ -0,0 +1,139 @@
+// The meta process used by the preprocessor to generate the meta classes
+//
+// It is linked together with the meta output of all of the target's sources
+// which register their meta class functions in meta::functions()
+
+#include <meta.hpp>
+#include <shm_ring.hpp>
+
+#include <cstdlib>
+#include <deque>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+int main(int argc, char* argv[]) {
+#ifdef _WIN32
+  _setmode( _fileno( stdout ),  _O_BINARY );
+#endif
+
+#ifdef META_SHM_SUPPORTED
+  // the preprocessor can give us a shared memory channel instead of pipes
+  meta_shm::SharedChannel channel;
+  if (argc == 3 && std::string_view{argv[1]} == "--shm") {
+    channel = meta_shm::SharedChannel::open(std::atoi(argv[2]));
+    if (!channel) {
+      std::cerr << "can't open the shared memory channel\n";
+      return 1;
+    }
+  }
+  meta_shm::PeerAlive alive = [parent = getppid()] {
+    return getppid() == parent;
+  };
+  std::optional<meta_shm::RingWriter> ring_output;
+  std::optional<meta_shm::RingReader> ring_input;
+  std::optional<meta_shm::StreamRedirect> redirect_output, redirect_input;
+  if (channel) {
+    ring_output.emplace(channel->to_host, alive);
+    ring_input.emplace(channel->to_meta, alive);
+    redirect_output.emplace(std::cout, &*ring_output);
+    redirect_input.emplace(std::cin, &*ring_input);
+  }
+#endif
+
+  auto const& funs = meta::functions();
+  int mode;
+  while (true) {
+    if (!(std::cin >> mode)) {
+      // the preprocessor is gone
+      return 1;
+    }
+    switch (mode) {
+      case 1: {
+        std::cout << funs.size() << std::endl;
+        for (auto& kv : funs) {
+          std::cout << kv.first << '\n';
+        }
+        break;
+      }
+      case 2: {
+        std::string fun;
+        std::cin >> fun;
+        std::string output, model;
+        {
+          auto const type = meta::read_type();
+          meta::type t{type.name()};
+          auto f = funs.at(fun);
+          f(t, type);
+          output = t.get_representation();
+          model = t.get_model();
+        }
+        std::cout << 0 << '\n';
+        std::cout << output.size() << '\n';
+        std::cout << output << '\n';
+        std::cout << model.size() << '\n';
+        std::cout << model << std::endl;
+        break;
+      }
+      case 3:
+        return 0;
+      case 4: {
+        // batch of meta class requests, the bodies of all of the generated
+        // classes are parsed together and all outputs sent in one response
+        // NOTE: the bodies generated by meta functions called from the meta
+        // function of a class are still parsed one at a time when they
+        // return, so composed meta functions see what the earlier ones made
+        std::size_t n;
+        std::cin >> n;
+        std::vector<std::string> outputs, models;
+        {
+          // NOTE: deque since meta::type can't be moved once it has a body
+          std::deque<meta::type> targets;
+          std::vector<meta::type*> to_parse;
+          // NOTE: all of the batch is read before running the meta functions
+          // since the answers to their parse requests follow it
+          std::vector<std::pair<std::string, meta::type>> requests;
+          requests.reserve(n);
+          for (std::size_t i = 0; i < n; ++i) {
+            std::string fun;
+            std::cin >> fun;
+            requests.emplace_back(std::move(fun), meta::read_type());
+          }
+          for (auto& [fun, type] : requests) {
+            auto& t = targets.emplace_back(type.name());
+            t.defer_parsing();
+            auto f = funs.at(fun);
+            f(t, type);
+            to_parse.push_back(&t);
+          }
+
+          meta::parse_bodies(to_parse);
+          for (auto& t : targets) {
+            outputs.push_back(t.get_representation());
+          }
+          // finalizing can add to the body again
+          meta::parse_bodies(to_parse);
+          for (auto& t : targets) {
+            models.push_back(t.get_model());
+          }
+        }
+
+        std::cout << 0 << '\n';
+        std::cout << n << '\n';
+        for (std::size_t i = 0; i < n; ++i) {
+          std::cout << outputs[i].size() << '\n';
+          std::cout << outputs[i] << '\n';
+          std::cout << models[i].size() << '\n';
+          std::cout << models[i] << '\n';
+        }
+        std::cout.flush();
+        break;
+      }
+      default:
+        std::cout << "unknown mode " << mode;
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,320 @@
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+// Shared memory transport between the preprocessor and the meta process
+//
+// The region holds one single producer single consumer ring buffer for each
+// direction. The streams format straight into the ring and parse straight
+// out of it, so nothing goes through the kernel except for the wakeups.
+
+#if defined(__linux__)
+#define META_SHM_SUPPORTED 1
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <istream>
+#include <new>
+#include <ostream>
+#include <streambuf>
+#include <utility>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace meta_shm {
+constexpr std::uint32_t ring_capacity = 1u << 20;
+
+// NOTE: the head and tail are free running, the capacity being a power of 2
+// keeps the offsets right when they wrap around
+static_assert((ring_capacity & (ring_capacity - 1)) == 0,
+              "ring capacity must be a power of 2");
+static_assert(std::atomic<std::uint32_t>::is_always_lock_free,
+              "the ring needs lock free atomics to be shared between processes");
+
+struct Ring {
+  // bytes written so far, only changed by the producer
+  alignas(64) std::atomic<std::uint32_t> head{0};
+  // bytes read so far, only changed by the consumer
+  alignas(64) std::atomic<std::uint32_t> tail{0};
+  alignas(64) std::atomic<std::uint32_t> reader_waiting{0};
+  std::atomic<std::uint32_t> writer_waiting{0};
+  alignas(64) char data[ring_capacity];
+};
+
+/**
+ * Layout of the shared region
+ */
+struct Channel {
+  Ring to_meta;
+  Ring to_host;
+};
+
+using PeerAlive = std::function<bool()>;
+
+inline void futex_wait(std::atomic<std::uint32_t>& word,
+                       std::uint32_t expected) {
+  // NOTE: wake up once in a while to check if the other side is still alive
+  timespec timeout{0, 100'000'000};
+  syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAIT,
+          expected, &timeout, nullptr, 0);
+}
+
+inline void futex_wake(std::atomic<std::uint32_t>& word) {
+  syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAKE,
+          INT_MAX, nullptr, nullptr, 0);
+}
+
+/**
+ * Wait until ready returns true, spinning for a bit before sleeping on the
+ * futex word. Returns false if the other side died meanwhile
+ */
+template <class Ready>
+bool wait_for(Ready ready, std::atomic<std::uint32_t>& word,
+              std::atomic<std::uint32_t>& waiting, PeerAlive const& alive) {
+  constexpr int spin_limit = 2000;
+  for (int spins = 0; !ready(); ++spins) {
+    if (spins < spin_limit) {
+      continue;
+    }
+
+    auto value = word.load();
+    waiting.store(1);
+    if (!ready()) {
+      futex_wait(word, value);
+    }
+    waiting.store(0);
+
+    if (!ready() && alive && !alive()) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/**
+ * Producer side of a ring, the put area is the free space of the ring
+ *
+ * The written content is made visible to the consumer on flush
+ * or when the free space runs out
+ */
+class RingWriter : public std::streambuf {
+  Ring& ring;
+  std::uint32_t head;
+  PeerAlive alive;
+
+  void commit() {
+    auto written = static_cast<std::uint32_t>(pptr() - pbase());
+    if (written == 0) {
+      return;
+    }
+
+    head += written;
+    ring.head.store(head);
+    if (ring.reader_waiting.load()) {
+      futex_wake(ring.head);
+    }
+    setp(pptr(), epptr());
+  }
+
+  std::uint32_t free_space() const {
+    return ring_capacity - (head - ring.tail.load(std::memory_order_acquire));
+  }
+
+  bool reserve() {
+    auto has_space = [this] { return free_space() != 0; };
+    if (!wait_for(has_space, ring.tail, ring.writer_waiting, alive)) {
+      return false;
+    }
+
+    auto offset = head % ring_capacity;
+    auto contiguous = std::min(free_space(), ring_capacity - offset);
+    setp(ring.data + offset, ring.data + offset + contiguous);
+    return true;
+  }
+
+ protected:
+  int_type overflow(int_type c) override {
+    commit();
+    if (!reserve()) {
+      return traits_type::eof();
+    }
+
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+      *pptr() = traits_type::to_char_type(c);
+      pbump(1);
+    }
+    return traits_type::not_eof(c);
+  }
+
+  int sync() override {
+    commit();
+    return 0;
+  }
+
+ public:
+  RingWriter(Ring& ring, PeerAlive alive = {})
+      : ring{ring}, head{ring.head.load()}, alive{std::move(alive)} {}
+
+  ~RingWriter() { commit(); }
+
+  void set_peer_alive(PeerAlive peer_alive) { alive = std::move(peer_alive); }
+};
+
+/**
+ * Consumer side of a ring, the get area is the readable part of the ring
+ *
+ * The read content is given back to the producer when more is needed
+ */
+class RingReader : public std::streambuf {
+  Ring& ring;
+  std::uint32_t tail;
+  PeerAlive alive;
+
+  std::uint32_t available() const {
+    return ring.head.load(std::memory_order_acquire) - tail;
+  }
+
+ protected:
+  int_type underflow() override {
+    tail += static_cast<std::uint32_t>(gptr() - eback());
+    ring.tail.store(tail);
+    if (ring.writer_waiting.load()) {
+      futex_wake(ring.tail);
+    }
+    setg(nullptr, nullptr, nullptr);
+
+    auto has_data = [this] { return available() != 0; };
+    if (!wait_for(has_data, ring.head, ring.reader_waiting, alive)) {
+      return traits_type::eof();
+    }
+
+    auto offset = tail % ring_capacity;
+    auto contiguous = std::min(available(), ring_capacity - offset);
+    auto* begin = ring.data + offset;
+    setg(begin, begin, begin + contiguous);
+    return traits_type::to_int_type(*gptr());
+  }
+
+ public:
+  RingReader(Ring& ring, PeerAlive alive = {})
+      : ring{ring}, tail{ring.tail.load()}, alive{std::move(alive)} {}
+
+  void set_peer_alive(PeerAlive peer_alive) { alive = std::move(peer_alive); }
+};
+
+/**
+ * Owns the mapping of the shared region
+ *
+ * The host creates it, the file descriptor is inherited by the meta process
+ * which opens it by it's number
+ */
+class SharedChannel {
+  Channel* channel = nullptr;
+  int fd = -1;
+
+  SharedChannel(Channel* channel, int fd) : channel{channel}, fd{fd} {}
+
+  static Channel* map(int fd) {
+    void* addr = mmap(nullptr, sizeof(Channel), PROT_READ | PROT_WRITE,
+                      MAP_SHARED, fd, 0);
+    return addr == MAP_FAILED ? nullptr : static_cast<Channel*>(addr);
+  }
+
+ public:
+  SharedChannel() = default;
+
+  SharedChannel(SharedChannel&& c)
+      : channel{std::exchange(c.channel, nullptr)},
+        fd{std::exchange(c.fd, -1)} {}
+
+  SharedChannel& operator=(SharedChannel&& c) {
+    std::swap(channel, c.channel);
+    std::swap(fd, c.fd);
+    return *this;
+  }
+
+  ~SharedChannel() {
+    if (channel) {
+      munmap(channel, sizeof(Channel));
+    }
+    if (fd != -1) {
+      close(fd);
+    }
+  }
+
+  /**
+   * Create a new region, empty channel if it is not supported
+   */
+  static SharedChannel create() {
+    // NOTE: closed on exec, only the meta process given the region inherits
+    // it, see inherit_in_child
+    int fd = memfd_create("meta_channel", MFD_CLOEXEC);
+    if (fd == -1) {
+      return {};
+    }
+
+    if (ftruncate(fd, sizeof(Channel)) == -1) {
+      close(fd);
+      return {};
+    }
+
+    auto* channel = map(fd);
+    if (!channel) {
+      close(fd);
+      return {};
+    }
+
+    return {new (channel) Channel, fd};
+  }
+
+  /**
+   * Open a region created by the other process
+   */
+  static SharedChannel open(int fd) {
+    auto* channel = map(fd);
+    return channel ? SharedChannel{channel, fd} : SharedChannel{};
+  }
+
+  explicit operator bool() const { return channel != nullptr; }
+
+  Channel* operator->() const { return channel; }
+
+  int get_fd() const { return fd; }
+
+  /**
+   * Keep the region open in the process about to be executed, called in
+   * the child between the fork and the exec
+   */
+  void inherit_in_child() const {
+    fcntl(fd, F_SETFD, fcntl(fd, F_GETFD) & ~FD_CLOEXEC);
+  }
+};
+
+/**
+ * Point the stream to another buffer until destroyed
+ */
+class StreamRedirect {
+  std::ios& stream;
+  std::streambuf* old;
+
+ public:
+  StreamRedirect(std::ios& stream, std::streambuf* buf)
+      : stream{stream}, old{stream.rdbuf(buf)} {}
+
+  StreamRedirect(StreamRedirect const&) = delete;
+
+  ~StreamRedirect() { stream.rdbuf(old); }
+};
+}  // namespace meta_shm
+
+#endif  // __linux__
+
+#endif  //! SHM_RING_H
@@ -0,0 +1,111 @@
+#ifndef META_POOL_H
+#define META_POOL_H
+
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <unordered_set>
+#include <utility>
+
+#include <meta_cache.hpp>
+#include <meta_process.hpp>
+
+namespace meta_classes {
+/**
+ * A meta process after its handshake, with the meta classes it has and the
+ * expansions it already generated
+ */
+struct WarmMeta {
+  fs::file_time_type exe_time;
+  MetaProcess process;
+  std::unordered_set<std::string> meta_classes;
+  MetaCache cache;
+};
+
+/**
+ * Meta processes kept alive between the runs of a resident preprocessor,
+ * keyed by the meta executable and the cache directory
+ *
+ * A meta process is only reused while its executable is not rebuilt, only
+ * enabled by the preprocessor server
+ */
+class MetaPool {
+  inline static bool enabled = false;
+  inline static std::mutex mutex;
+  inline static std::map<std::pair<std::string, std::string>, WarmMeta> pool;
+
+  static void stop(WarmMeta& warm) {
+    warm.process.output << 3 << std::endl;
+    warm.process.wait();
+  }
+
+ public:
+  static void enable() { enabled = true; }
+
+  static std::optional<fs::file_time_type> exe_time(std::string const& exe) {
+    std::error_code e;
+    auto time = fs::last_write_time(exe, e);
+    return e ? std::nullopt : std::optional{time};
+  }
+
+  static bool is_enabled() { return enabled; }
+
+  /**
+   * Take the warm meta process of the executable, empty if there is none
+   * or the executable changed since it was started
+   */
+  static std::optional<WarmMeta> take(std::string const& exe,
+                                      std::string const& cache_dir) {
+    if (!enabled) {
+      return std::nullopt;
+    }
+
+    std::lock_guard lock{mutex};
+    auto it = pool.find({exe, cache_dir});
+    if (it == pool.end()) {
+      return std::nullopt;
+    }
+
+    auto warm = std::move(it->second);
+    pool.erase(it);
+    if (warm.exe_time != exe_time(exe) || !warm.process.ok()) {
+      stop(warm);
+      return std::nullopt;
+    }
+    return warm;
+  }
+
+  /**
+   * Keep the meta process for the next run, false if the pool is disabled
+   */
+  static bool give(std::string const& exe, std::string const& cache_dir,
+                   WarmMeta&& warm) {
+    if (!enabled) {
+      return false;
+    }
+
+    std::lock_guard lock{mutex};
+    auto [it, added] = pool.try_emplace({exe, cache_dir}, std::move(warm));
+    if (!added) {
+      stop(warm);
+    }
+    return true;
+  }
+
+  /**
+   * Stop all of the meta processes
+   */
+  static void clear() {
+    std::lock_guard lock{mutex};
+    for (auto& [key, warm] : pool) {
+      stop(warm);
+    }
+    pool.clear();
+  }
+};
+}  // namespace meta_classes
+
+#endif  // META_POOL_H
@@ -1,38 +1,142 @@
 #ifndef META_PROCESS_H
 #define META_PROCESS_H
 
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+
 #include <boost/process.hpp>
+#include <boost/process/extend.hpp>
+
+#include <meta_include/shm_ring.hpp>
+
+#ifdef META_SHM_SUPPORTED
+#include <sys/types.h>
+#include <sys/wait.h>
+#endif
 
 namespace bp = boost::process;
 
 namespace meta_classes {
+/**
+ * How the requests and responses are moved between us and the meta process
+ */
+enum class MetaTransport { Pipe, SharedMemory };
+
+constexpr MetaTransport default_meta_transport() {
+#ifdef META_SHM_SUPPORTED
+  return MetaTransport::SharedMemory;
+#else
+  return MetaTransport::Pipe;
+#endif
+}
+
 class MetaProcess {
   bp::child process;
+  bp::opstream pipe_output;
+  bp::ipstream pipe_input;
+
+#ifdef META_SHM_SUPPORTED
+  meta_shm::SharedChannel channel;
+  std::unique_ptr<meta_shm::RingWriter> ring_output;
+  std::unique_ptr<meta_shm::RingReader> ring_input;
+
+  /**
+   * Start the meta process with the shared region instead of pipes,
+   * false if the region can't be created
+   */
+  bool start_shared(std::string_view process_name) {
+    channel = meta_shm::SharedChannel::create();
+    if (!channel) {
+      return false;
+    }
+
+    // NOTE: the region is only inherited by this meta process, not by the
+    // other processes started meanwhile, e.g. the meta processes of the
+    // other sources processed in parallel
+    auto inherit = bp::extend::on_exec_setup(
+        [this](auto&) { channel.inherit_in_child(); });
+    process = bp::child(process_name.data(), "--shm",
+                        std::to_string(channel.get_fd()), inherit);
+    // NOTE: checked without reaping it so the child can still be waited on
+    meta_shm::PeerAlive alive = [pid = process.id()] {
+      siginfo_t info{};
+      return waitid(P_PID, pid, &info, WEXITED | WNOHANG | WNOWAIT) == 0 &&
+             info.si_pid == 0;
+    };
+    ring_output = std::make_unique<meta_shm::RingWriter>(channel->to_meta, alive);
+    ring_input = std::make_unique<meta_shm::RingReader>(channel->to_host, alive);
+    return true;
+  }
+#endif
+
+  void bind_streams() {
+#ifdef META_SHM_SUPPORTED
+    if (ring_output) {
+      output.rdbuf(ring_output.get());
+      input.rdbuf(ring_input.get());
+      // the requests are flushed before waiting for their response
+      input.tie(&output);
+      return;
+    }
+#endif
+    output.rdbuf(pipe_output.rdbuf());
+    input.rdbuf(pipe_input.rdbuf());
+  }
 
  public:
-  bp::opstream output;
-  bp::ipstream input;
+  std::ostream output{nullptr};
+  std::istream input{nullptr};
+
+  MetaProcess() { bind_streams(); }
 
-  MetaProcess() = default;
+  MetaProcess(std::string_view process_name,
+              MetaTransport transport = default_meta_transport()) {
+    if (process_name.empty()) {
+      bind_streams();
+      return;
+    }
 
-  MetaProcess(std::string_view process_name) {
-    if (!process_name.empty()) {
-      this->process = bp::child(process_name.data(), bp::std_out > input,
-                                bp::std_in < output);
+#ifdef META_SHM_SUPPORTED
+    if (transport == MetaTransport::SharedMemory &&
+        start_shared(process_name)) {
+      bind_streams();
+      return;
     }
+#endif
+
+    this->process = bp::child(process_name.data(), bp::std_out > pipe_input,
+                              bp::std_in < pipe_output);
+    bind_streams();
   }
 
   // NOTE: something is wrong with the defaut move of basic_opstream so we move
   // the pipe
   MetaProcess(MetaProcess&& p)
       : process{std::move(p.process)},
-        output{std::move(p.output.pipe())},
-        input{std::move(p.input.pipe())} {}
+        pipe_output{std::move(p.pipe_output.pipe())},
+        pipe_input{std::move(p.pipe_input.pipe())}
+#ifdef META_SHM_SUPPORTED
+        ,
+        channel{std::move(p.channel)},
+        ring_output{std::move(p.ring_output)},
+        ring_input{std::move(p.ring_input)}
+#endif
+  {
+    bind_streams();
+  }
 
   MetaProcess& operator=(MetaProcess&& p) {
     process = std::move(p.process);
-    output = std::move(p.output.pipe());
-    input = std::move(p.input.pipe());
+    pipe_output = std::move(p.pipe_output.pipe());
+    pipe_input = std::move(p.pipe_input.pipe());
+#ifdef META_SHM_SUPPORTED
+    channel = std::move(p.channel);
+    ring_output = std::move(p.ring_output);
+    ring_input = std::move(p.ring_input);
+#endif
+    bind_streams();
 
     return *this;
   }
@@ -43,6 +147,17 @@ class MetaProcess {
     std::error_code e;
     process.wait(e);
   }
+
+  /**
+   * Stop a meta process that can't be talked to anymore
+   */
+  void terminate() noexcept {
+    std::error_code e;
+    if (process.valid() && process.running(e)) {
+      process.terminate(e);
+    }
+    process.wait(e);
+  }
 };
 }  // namespace meta_classes
 
@@ -0,0 +1,81 @@
+#ifndef META_WORKER_H
+#define META_WORKER_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace meta_classes {
+/**
+ * Runs the meta class requests one after the other on a separate thread
+ *
+ * The meta process talks over a single pair of pipes and can send requests
+ * of it's own in the middle of a response, so all the communication with it
+ * is done by this one thread while the preprocessor continues parsing.
+ */
+class MetaWorker {
+  std::mutex mutex;
+  std::condition_variable has_tasks;
+  std::deque<std::function<void()>> tasks;
+  bool done = false;
+  std::thread worker;
+
+  void run() {
+    while (true) {
+      std::function<void()> task;
+      {
+        std::unique_lock lock{mutex};
+        has_tasks.wait(lock, [this] { return done || !tasks.empty(); });
+        if (tasks.empty()) {
+          return;
+        }
+
+        task = std::move(tasks.front());
+        tasks.pop_front();
+      }
+
+      task();
+    }
+  }
+
+ public:
+  MetaWorker() : worker{[this] { run(); }} {}
+
+  MetaWorker(MetaWorker const&) = delete;
+  MetaWorker& operator=(MetaWorker const&) = delete;
+
+  /**
+   * Finishes all of the pushed tasks before returning
+   */
+  ~MetaWorker() {
+    {
+      std::lock_guard lock{mutex};
+      done = true;
+    }
+    has_tasks.notify_one();
+    worker.join();
+  }
+
+  /**
+   * Queue the task
+   *
+   * NOTE: the task hands its results and its errors to the ones waiting on
+   * it itself, an exception escaping the task terminates
+   */
+  template <class Task>
+  void push(Task&& task) {
+    // NOTE: shared since the task can own move only promises
+    auto shared = std::make_shared<std::decay_t<Task>>(std::forward<Task>(task));
+    {
+      std::lock_guard lock{mutex};
+      tasks.emplace_back([shared] { (*shared)(); });
+    }
+    has_tasks.notify_one();
+  }
+};
+}  // namespace meta_classes
+
+#endif  //! META_WORKER_H
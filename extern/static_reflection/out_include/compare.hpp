@@ -0,0 +1,294 @@
+#ifndef REFLECT_COMPARE_H
+#define REFLECT_COMPARE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <reflect.hpp>
+
+/**
+ * Comparison and hashing used by the generated Reflect<T>::equal,
+ * Reflect<T>::compare and Reflect<T>::hash
+ *
+ * compare is a three way comparison returning a negative number, zero or
+ * a positive number, members are compared in declaration order
+ */
+namespace reflect::cmp {
+namespace helper {
+template <class T>
+struct is_vector : std::false_type {};
+
+template <class T, class A>
+struct is_vector<std::vector<T, A>> : std::true_type {};
+
+template <class T, class = void>
+struct has_equal : std::false_type {};
+
+template <class T>
+struct has_equal<T, std::void_t<decltype(Reflect<T>::equal(
+                        std::declval<T const&>(), std::declval<T const&>()))>>
+    : std::true_type {};
+
+template <class T, class = void>
+struct has_compare : std::false_type {};
+
+template <class T>
+struct has_compare<T, std::void_t<decltype(Reflect<T>::compare(
+                          std::declval<T const&>(), std::declval<T const&>()))>>
+    : std::true_type {};
+
+template <class T, class = void>
+struct has_hash : std::false_type {};
+
+template <class T>
+struct has_hash<T, std::void_t<decltype(Reflect<T>::hash(
+                       std::declval<T const&>()))>> : std::true_type {};
+
+/**
+ * Types equal exactly when their bytes are equal, so they can be hashed
+ * as bytes, this excludes floating points and types with padding
+ */
+template <class T>
+constexpr bool is_bytes_v =
+    std::has_unique_object_representations_v<T> && !has_hash<T>::value;
+
+template <class T, class = void>
+struct has_equal_operator : std::false_type {};
+
+template <class T>
+struct has_equal_operator<T, std::void_t<decltype(std::declval<T const&>() ==
+                                                  std::declval<T const&>())>>
+    : std::true_type {};
+
+template <class T, class = void>
+struct has_less_operator : std::false_type {};
+
+template <class T>
+struct has_less_operator<T, std::void_t<decltype(std::declval<T const&>() <
+                                                 std::declval<T const&>())>>
+    : std::true_type {};
+
+template <class T, class = void>
+struct has_std_hash : std::false_type {};
+
+template <class T>
+struct has_std_hash<T, std::void_t<decltype(std::hash<T>{}(
+                           std::declval<T const&>()))>> : std::true_type {};
+
+/**
+ * Check a member supports what equal, compare and hash do with it, vectors
+ * by their elements as their operators accept any element type
+ */
+template <class T>
+constexpr bool is_equality_comparable() {
+  if constexpr (is_vector<T>::value) {
+    return is_equality_comparable<typename T::value_type>();
+  } else {
+    return has_equal_operator<T>::value;
+  }
+}
+
+template <class T>
+constexpr bool is_comparable() {
+  if constexpr (has_compare<T>::value || std::is_same_v<T, std::string>) {
+    return true;
+  } else if constexpr (is_vector<T>::value) {
+    return is_comparable<typename T::value_type>();
+  } else {
+    return has_less_operator<T>::value;
+  }
+}
+
+template <class T>
+constexpr bool is_hashable() {
+  if constexpr (has_hash<T>::value || std::is_same_v<T, std::string> ||
+                std::is_same_v<T, std::vector<bool>>) {
+    return true;
+  } else if constexpr (is_vector<T>::value) {
+    return is_hashable<typename T::value_type>();
+  } else {
+    return is_bytes_v<T> || has_std_hash<T>::value;
+  }
+}
+
+template <class M>
+struct member;
+
+template <class C, class T>
+struct member<T C::*> {
+  using type = T;
+};
+
+template <auto M>
+using member_t = typename member<decltype(M)>::type;
+
+template <auto M, class T>
+char const* address(T const& v) {
+  return reinterpret_cast<char const*>(&(v.*M));
+}
+
+/**
+ * Check if the members are laid out one after the other without padding,
+ * written as a fold so the optimizer reduces it to a constant
+ */
+template <auto M, auto... Ms, class T>
+bool is_contiguous(T const& v) {
+  char const* end = address<M>(v) + sizeof(member_t<M>);
+  return ((address<Ms>(v) == end &&
+           (end = address<Ms>(v) + sizeof(member_t<Ms>), true)) &&
+          ...);
+}
+}  // namespace helper
+
+/**
+ * Check the data members support the generated Reflect<T>::equal,
+ * Reflect<T>::compare and Reflect<T>::hash, which are removed otherwise
+ */
+template <class... Ms>
+constexpr bool equality_comparable_v =
+    (helper::is_equality_comparable<Ms>() && ...);
+
+template <class... Ms>
+constexpr bool comparable_v = (helper::is_comparable<Ms>() && ...);
+
+template <class... Ms>
+constexpr bool hashable_v = (helper::is_hashable<Ms>() && ...);
+
+inline std::size_t mix(std::uint64_t x) {
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdULL;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53ULL;
+  x ^= x >> 33;
+  return static_cast<std::size_t>(x);
+}
+
+inline std::size_t combine(std::size_t seed, std::size_t value) {
+  return seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+}
+
+/**
+ * Hash the bytes sixteen at a time in two independent lanes, the result
+ * is only finalized by mix once the whole object is hashed
+ */
+inline std::size_t hash_bytes(std::size_t seed, void const* data,
+                              std::size_t size) {
+  constexpr std::uint64_t k1 = 0x9e3779b97f4a7c15ULL;
+  constexpr std::uint64_t k2 = 0xc2b2ae3d27d4eb4fULL;
+  auto bytes = static_cast<unsigned char const*>(data);
+  std::uint64_t a = seed ^ (size * k1);
+  std::uint64_t b = seed + k2;
+  for (; size >= 16; size -= 16, bytes += 16) {
+    std::uint64_t words[2];
+    std::memcpy(words, bytes, 16);
+    a = (a ^ words[0]) * k1;
+    b = (b ^ words[1]) * k2;
+    a ^= a >> 29;
+    b ^= b >> 31;
+  }
+
+  // NOTE: the tail is read with fixed size loads that may overlap
+  // instead of a memcpy of a variable size
+  if (size > 0) {
+    std::uint64_t first = 0;
+    std::uint64_t last = 0;
+    if (size >= 8) {
+      std::memcpy(&first, bytes, 8);
+      std::memcpy(&last, bytes + size - 8, 8);
+    } else if (size >= 4) {
+      std::uint32_t low;
+      std::uint32_t high;
+      std::memcpy(&low, bytes, 4);
+      std::memcpy(&high, bytes + size - 4, 4);
+      first = low;
+      last = high;
+    } else {
+      first = bytes[0] | (bytes[size / 2] << 8) | (bytes[size - 1] << 16);
+    }
+    a = (a ^ first) * k1;
+    b = (b ^ last) * k2;
+  }
+  return a ^ (b * k1);
+}
+
+template <class T>
+std::size_t hash_value(T const& v) {
+  if constexpr (helper::has_hash<T>::value) {
+    return Reflect<T>::hash(v);
+  } else if constexpr (std::is_same_v<T, std::string>) {
+    return hash_bytes(0, v.data(), v.size());
+  } else if constexpr (std::is_same_v<T, std::vector<bool>>) {
+    // NOTE: packed, so there is no data() to hash
+    return std::hash<T>{}(v);
+  } else if constexpr (helper::is_vector<T>::value) {
+    using Element = typename T::value_type;
+    if constexpr (helper::is_bytes_v<Element>) {
+      return hash_bytes(0, v.data(), v.size() * sizeof(Element));
+    } else {
+      std::size_t h = v.size();
+      for (auto& e : v) {
+        h = combine(h, hash_value(e));
+      }
+      return h;
+    }
+  } else if constexpr (helper::is_bytes_v<T>) {
+    return hash_bytes(0, &v, sizeof(T));
+  } else {
+    return std::hash<T>{}(v);
+  }
+}
+
+/**
+ * Hash a run of data members in bulk when their bytes are their values
+ * and they are contiguous, member by member otherwise
+ */
+template <auto... Ms, class T>
+std::size_t hash_run(std::size_t seed, T const& v) {
+  if constexpr ((helper::is_bytes_v<helper::member_t<Ms>> && ...)) {
+    if (helper::is_contiguous<Ms...>(v)) {
+      constexpr std::size_t size = (sizeof(helper::member_t<Ms>) + ...);
+      return hash_bytes(
+          seed, &(v.*reflect::helper::get<0>(value_list<Ms...>{})), size);
+    }
+  }
+
+  ((seed = combine(seed, hash_value(v.*Ms))), ...);
+  return seed;
+}
+
+template <class T>
+int compare(T const& a, T const& b) {
+  if constexpr (helper::has_compare<T>::value) {
+    return Reflect<T>::compare(a, b);
+  } else if constexpr (std::is_same_v<T, std::string>) {
+    return a.compare(b);
+  } else if constexpr (helper::is_vector<T>::value) {
+    auto size = std::min(a.size(), b.size());
+    for (std::size_t i = 0; i < size; ++i) {
+      if (int c = compare(a[i], b[i])) {
+        return c;
+      }
+    }
+    return a.size() < b.size() ? -1 : b.size() < a.size() ? 1 : 0;
+  } else {
+    return a < b ? -1 : b < a ? 1 : 0;
+  }
+}
+
+/**
+ * Hash functor of the reflected classes, for the classes whose std::hash
+ * specialization can't be generated
+ */
+template <class T>
+struct hash {
+  std::size_t operator()(T const& v) const { return Reflect<T>::hash(v); }
+};
+}  // namespace reflect::cmp
+
+#endif  // REFLECT_COMPARE_H
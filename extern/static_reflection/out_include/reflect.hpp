@@ -1,6 +1,11 @@
 #ifndef REFLECT_H
 #define REFLECT_H
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
 #include <tuple>
 #include <type_traits>
 #include <utility>
@@ -9,6 +14,73 @@ namespace reflect {
 template <typename T>
 struct Reflect {};
 
+/**
+ * Flat packs of types and values used by the generated metadata,
+ * unlike std::tuple they are indexed without recursive instantiations
+ */
+template <class... Ts>
+struct type_list {};
+
+template <auto... Vs>
+struct value_list {};
+
+namespace helper {
+template <std::size_t I, class T>
+struct indexed {
+  using type = T;
+};
+
+template <class Is, class... Ts>
+struct indexer;
+
+template <std::size_t... Is, class... Ts>
+struct indexer<std::index_sequence<Is...>, Ts...> : indexed<Is, Ts>... {};
+
+// NOTE: overload resolution picks the one base with the index
+// so no matter the size of the pack this is one instantiation
+template <std::size_t I, class T>
+indexed<I, T> select(indexed<I, T> const&);
+
+template <std::size_t I, class... Ts>
+using type_at = typename decltype(select<I>(
+    std::declval<indexer<std::index_sequence_for<Ts...>, Ts...> const&>()))::
+    type;
+
+/**
+ * Get the N-th value of a value_list or a std::tuple/std::array
+ */
+template <std::size_t N, auto... Vs>
+constexpr auto get(value_list<Vs...>) {
+  return type_at<N, std::integral_constant<decltype(Vs), Vs>...>::value;
+}
+
+template <std::size_t N, class T>
+constexpr auto get(T const& t) {
+  return std::get<N>(t);
+}
+
+template <class T>
+struct pack_size : std::tuple_size<T> {};
+
+template <class... Ts>
+struct pack_size<type_list<Ts...>>
+    : std::integral_constant<std::size_t, sizeof...(Ts)> {};
+
+template <auto... Vs>
+struct pack_size<value_list<Vs...>>
+    : std::integral_constant<std::size_t, sizeof...(Vs)> {};
+
+template <std::size_t N, class T>
+struct pack_element {
+  using type = std::tuple_element_t<N, T>;
+};
+
+template <std::size_t N, class... Ts>
+struct pack_element<N, type_list<Ts...>> {
+  using type = type_at<N, Ts...>;
+};
+}  // namespace helper
+
 enum class ObjectType { CLASS, STRUCT, UNION, ENUM };
 
 template <class T>
@@ -50,12 +122,12 @@ constexpr auto get_source_column_v = get_source_column<T>::value;
 template <class T>
 constexpr auto get_source_file_name_v = get_source_file_name<T>::value;
 
-// for not we use tupple instead od sequence
+// NOTE: sequences are type_lists, tuples are still accepted
 template <typename T>
-constexpr auto get_size_v = std::tuple_size<T>();
+constexpr auto get_size_v = helper::pack_size<T>::value;
 
 template <int N, typename T>
-using get_element_t = std::tuple_element_t<N, T>;
+using get_element_t = typename helper::pack_element<N, T>::type;
 
 // 21.11.4.4 Named operations
 template <class T>
@@ -127,23 +199,23 @@ constexpr auto is_union_v = is_union<T>::value;
 namespace helper {
 template <typename T, int N>
 struct PublicMember {
-  static constexpr auto pointer = std::get<N>(T::public_data_members);
-  using type = std::tuple_element_t<N, typename T::public_data_member_types>;
-  static constexpr auto name = std::get<N>(T::public_data_member_names);
+  static constexpr auto pointer = helper::get<N>(T::public_data_members);
+  using type = get_element_t<N, typename T::public_data_member_types>;
+  static constexpr auto name = helper::get<N>(T::public_data_member_names);
 };
 
 template <typename T, int N>
 struct DataMember {
-  static constexpr auto pointer = std::get<N>(T::data_members);
-  using type = std::tuple_element_t<N, typename T::data_member_types>;
-  static constexpr auto name = std::get<N>(T::data_member_names);
+  static constexpr auto pointer = helper::get<N>(T::data_members);
+  using type = get_element_t<N, typename T::data_member_types>;
+  static constexpr auto name = helper::get<N>(T::data_member_names);
 };
 
 template <typename T, int N>
 struct Enumerator {
-  static constexpr auto constant = std::get<N>(T::enumerator_constants);
+  static constexpr auto constant = helper::get<N>(T::enumerator_constants);
   using type = T;
-  static constexpr auto name = std::get<N>(T::enumerator_names);
+  static constexpr auto name = helper::get<N>(T::enumerator_names);
 };
 
 template <template <typename, int> class M, typename T, typename U>
@@ -151,14 +223,15 @@ struct selector;
 
 template <template <typename, int> class M, typename T, std::size_t... Is>
 struct selector<M, T, std::index_sequence<Is...>> {
-  using type = std::tuple<M<T, Is>...>;
+  using type = type_list<M<T, Is>...>;
 };
 }  // namespace helper
 
 // 21.11.4.8 Record operations
 template <class T>
 struct get_public_data_members {
-  static constexpr int N = std::tuple_size<decltype(T::public_data_members)>();
+  static constexpr int N =
+      get_size_v<std::decay_t<decltype(T::public_data_members)>>;
   using type = typename helper::selector<helper::PublicMember, T,
                                          std::make_index_sequence<N>>::type;
 };
@@ -166,7 +239,7 @@ template <class T>
 struct get_accessible_data_members;
 template <class T>
 struct get_data_members {
-  static constexpr int N = std::tuple_size<decltype(T::data_members)>();
+  static constexpr int N = get_size_v<std::decay_t<decltype(T::data_members)>>;
   using type = typename helper::selector<helper::DataMember, T,
                                          std::make_index_sequence<N>>::type;
 };
@@ -220,7 +293,8 @@ struct is_scoped_enum {
 };
 template <class T>
 struct get_enumerators {
-  static constexpr int N = std::tuple_size<decltype(T::enumerator_names)>();
+  static constexpr int N =
+      get_size_v<std::decay_t<decltype(T::enumerator_names)>>;
   using type = typename helper::selector<helper::Enumerator, T,
                                          std::make_index_sequence<N>>::type;
 };
@@ -231,6 +305,7 @@ struct get_underlying_type {
 
 template <class T>
 constexpr auto is_scoped_enum_v = is_scoped_enum<T>::value;
+
 template <class T>
 using get_enumerators_t = typename get_enumerators<T>::type;
 template <class T>
@@ -276,6 +351,412 @@ struct is_inline;
 
 template <class T>
 constexpr auto is_inline_v = is_inline<T>::value;
+
+// Extensions: runtime layout of the data members
+/**
+ * The kind of a data member's type as stored in the layout tables,
+ * integers are identified by their width and signedness
+ */
+enum class TypeId {
+  OTHER,
+  BOOL,
+  CHAR,
+  INT8,
+  UINT8,
+  INT16,
+  UINT16,
+  INT32,
+  UINT32,
+  INT64,
+  UINT64,
+  FLOAT,
+  DOUBLE,
+  LONG_DOUBLE,
+  ENUM,
+  POINTER
+};
+
+namespace helper {
+template <class T>
+constexpr TypeId integral_type_id() {
+  constexpr bool is_signed = std::is_signed_v<T>;
+  switch (sizeof(T)) {
+    case 1:
+      return is_signed ? TypeId::INT8 : TypeId::UINT8;
+    case 2:
+      return is_signed ? TypeId::INT16 : TypeId::UINT16;
+    case 4:
+      return is_signed ? TypeId::INT32 : TypeId::UINT32;
+    case 8:
+      return is_signed ? TypeId::INT64 : TypeId::UINT64;
+    default:
+      return TypeId::OTHER;
+  }
+}
+
+template <class T>
+constexpr TypeId type_id() {
+  if constexpr (std::is_same_v<T, bool>) {
+    return TypeId::BOOL;
+  } else if constexpr (std::is_same_v<T, char>) {
+    return TypeId::CHAR;
+  } else if constexpr (std::is_integral_v<T>) {
+    return integral_type_id<T>();
+  } else if constexpr (std::is_same_v<T, float>) {
+    return TypeId::FLOAT;
+  } else if constexpr (std::is_same_v<T, double>) {
+    return TypeId::DOUBLE;
+  } else if constexpr (std::is_same_v<T, long double>) {
+    return TypeId::LONG_DOUBLE;
+  } else if constexpr (std::is_enum_v<T>) {
+    return TypeId::ENUM;
+  } else if constexpr (std::is_pointer_v<T>) {
+    return TypeId::POINTER;
+  } else {
+    return TypeId::OTHER;
+  }
+}
+
+template <class Meta, class Obj, class F, std::size_t... Is>
+constexpr void for_each_member(Obj& obj, F& f, std::index_sequence<Is...>) {
+  (f(helper::get<Is>(Meta::data_member_names),
+     obj.*helper::get<Is>(Meta::data_members)),
+   ...);
+}
+}  // namespace helper
+
+template <class T>
+constexpr auto type_id_v = helper::type_id<std::remove_cv_t<T>>();
+
+/**
+ * Tables with one entry per data member in declaration order
+ * (public, protected then private) for standard layout classes,
+ * the object's members can then be reached through its address
+ * in a plain loop instead of a template recursion
+ */
+template <class T>
+struct get_data_member_offsets {
+  static constexpr auto value = T::template layout<>::offsets;
+};
+template <class T>
+struct get_data_member_sizes {
+  static constexpr auto value = T::template layout<>::sizes;
+};
+template <class T>
+struct get_data_member_type_ids {
+  static constexpr auto value = T::template layout<>::type_ids;
+};
+
+template <class T>
+constexpr auto get_data_member_offsets_v = get_data_member_offsets<T>::value;
+template <class T>
+constexpr auto get_data_member_sizes_v = get_data_member_sizes<T>::value;
+template <class T>
+constexpr auto get_data_member_type_ids_v = get_data_member_type_ids<T>::value;
+
+/**
+ * Call f(name, member) for each data member of the reflected object
+ */
+template <class Obj, class F>
+constexpr void for_each_member(Obj&& obj, F&& f) {
+  using meta = Reflect<std::remove_cv_t<std::remove_reference_t<Obj>>>;
+  constexpr auto N = get_size_v<std::decay_t<decltype(meta::data_members)>>;
+  helper::for_each_member<meta>(obj, f, std::make_index_sequence<N>{});
+}
+
+// Extensions: enum to and from string conversion
+namespace helper {
+constexpr std::size_t next_pow2(std::size_t n) {
+  std::size_t p = 1;
+  while (p < n) {
+    p *= 2;
+  }
+  return p;
+}
+
+constexpr std::uint32_t hash(std::string_view s, std::uint32_t seed) {
+  // FNV-1a with a seeded basis and a final mix of the low bits
+  std::uint32_t h = 2166136261u ^ (seed * 0x9e3779b9u);
+  for (char c : s) {
+    h ^= static_cast<unsigned char>(c);
+    h *= 16777619u;
+  }
+  h ^= h >> 15;
+  h *= 0x2c1b3c6du;
+  h ^= h >> 12;
+  return h;
+}
+
+/**
+ * Name and value tables of a reflected enum built at compile time
+ *
+ * Values map to names through an array indexed by the value when the
+ * values are dense, through a binary search over the sorted values otherwise.
+ * Names map to values through a perfect hash: the names are split in buckets
+ * by a first hash and every bucket gets the seed of a second hash that places
+ * all of its names in free slots, so a lookup is two hashes and one compare
+ */
+template <class E>
+struct EnumStrings {
+  using meta = Reflect<E>;
+  using underlying = std::underlying_type_t<E>;
+  static constexpr std::size_t N =
+      get_size_v<std::decay_t<decltype(meta::enumerator_names)>>;
+  static constexpr std::size_t buckets_size = next_pow2(N);
+  static constexpr std::size_t slots_size = next_pow2(2 * N);
+  static constexpr std::size_t empty = N;
+
+  template <std::size_t... Is>
+  static constexpr std::array<std::string_view, N> make_names(
+      std::index_sequence<Is...>) {
+    return {{std::string_view{helper::get<Is>(meta::enumerator_names)}...}};
+  }
+
+  template <std::size_t... Is>
+  static constexpr std::array<E, N> make_constants(std::index_sequence<Is...>) {
+    return {{helper::get<Is>(meta::enumerator_constants)...}};
+  }
+
+  static constexpr auto names = make_names(std::make_index_sequence<N>{});
+  static constexpr auto constants =
+      make_constants(std::make_index_sequence<N>{});
+
+  static constexpr long long value(std::size_t i) {
+    return static_cast<long long>(static_cast<underlying>(constants[i]));
+  }
+
+  static constexpr long long min_value() {
+    long long min = N ? value(0) : 0;
+    for (std::size_t i = 1; i < N; ++i) {
+      min = value(i) < min ? value(i) : min;
+    }
+    return min;
+  }
+
+  static constexpr long long max_value() {
+    long long max = N ? value(0) : 0;
+    for (std::size_t i = 1; i < N; ++i) {
+      max = value(i) > max ? value(i) : max;
+    }
+    return max;
+  }
+
+  static constexpr long long min = min_value();
+  // NOTE: in unsigned since the values can span all of the 64 bits
+  static constexpr unsigned long long span =
+      static_cast<unsigned long long>(max_value()) -
+      static_cast<unsigned long long>(min);
+  static constexpr bool is_dense = span < 4 * N + 16;
+  static constexpr unsigned long long range = is_dense ? span + 1 : 0;
+
+  static constexpr unsigned long long offset(long long v) {
+    return static_cast<unsigned long long>(v) -
+           static_cast<unsigned long long>(min);
+  }
+
+  // name of each value from min, empty for values that are not enumerators
+  static constexpr auto make_dense() {
+    std::array<std::string_view, is_dense ? range : 1> dense{};
+    if constexpr (is_dense) {
+      for (std::size_t i = N; i-- > 0;) {
+        dense[offset(value(i))] = names[i];
+      }
+    }
+    return dense;
+  }
+
+  // indexes of the enumerators sorted by value
+  static constexpr auto make_sorted() {
+    std::array<std::size_t, N> sorted{};
+    for (std::size_t i = 0; i < N; ++i) {
+      std::size_t j = i;
+      for (; j > 0 && value(sorted[j - 1]) > value(i); --j) {
+        sorted[j] = sorted[j - 1];
+      }
+      sorted[j] = i;
+    }
+    return sorted;
+  }
+
+  // indexes of the enumerators sorted by name
+  static constexpr auto make_sorted_names() {
+    std::array<std::size_t, N> sorted{};
+    for (std::size_t i = 0; i < N; ++i) {
+      std::size_t j = i;
+      for (; j > 0 && names[sorted[j - 1]] > names[i]; --j) {
+        sorted[j] = sorted[j - 1];
+      }
+      sorted[j] = i;
+    }
+    return sorted;
+  }
+
+  // seeds tried for a bucket before falling back to the sorted names
+  static constexpr std::uint32_t max_seed = 1 << 12;
+
+  struct PerfectHash {
+    // a seed for the bucket's second hash or -(slot + 1) for single names
+    std::array<std::int64_t, buckets_size> seeds{};
+    std::array<std::size_t, slots_size> slots{};
+    // false if a bucket had no seed placing all of its names
+    bool ok = true;
+  };
+
+  static constexpr PerfectHash make_hash() {
+    PerfectHash ph{};
+    for (auto& slot : ph.slots) {
+      slot = empty;
+    }
+
+    // group the names by bucket, bucket b is [begins[b], begins[b + 1])
+    std::array<std::size_t, N> bucket_of{};
+    std::array<std::size_t, buckets_size + 1> begins{};
+    for (std::size_t i = 0; i < N; ++i) {
+      bucket_of[i] = hash(names[i], 0) & (buckets_size - 1);
+      ++begins[bucket_of[i] + 1];
+    }
+    std::size_t max_size = 0;
+    for (std::size_t b = 0; b < buckets_size; ++b) {
+      max_size = begins[b + 1] > max_size ? begins[b + 1] : max_size;
+      begins[b + 1] += begins[b];
+    }
+    std::array<std::size_t, N> grouped{};
+    auto ends = begins;
+    for (std::size_t i = 0; i < N; ++i) {
+      grouped[ends[bucket_of[i]]++] = i;
+    }
+
+    // place the biggest buckets first while there are many free slots
+    std::array<std::size_t, N> chosen{};
+    for (std::size_t size = max_size; size > 1; --size) {
+      for (std::size_t b = 0; b < buckets_size; ++b) {
+        if (begins[b + 1] - begins[b] != size) {
+          continue;
+        }
+
+        std::uint32_t seed = 1;
+        for (; seed <= max_seed; ++seed) {
+          bool placed = true;
+          for (std::size_t k = 0; k < size && placed; ++k) {
+            auto slot =
+                hash(names[grouped[begins[b] + k]], seed) & (slots_size - 1);
+            placed = ph.slots[slot] == empty;
+            for (std::size_t j = 0; j < k && placed; ++j) {
+              placed = chosen[j] != slot;
+            }
+            chosen[k] = slot;
+          }
+
+          if (placed) {
+            for (std::size_t k = 0; k < size; ++k) {
+              ph.slots[chosen[k]] = grouped[begins[b] + k];
+            }
+            ph.seeds[b] = seed;
+            break;
+          }
+        }
+        if (seed > max_seed) {
+          ph.ok = false;
+          return ph;
+        }
+      }
+    }
+
+    std::size_t free_slot = 0;
+    for (std::size_t b = 0; b < buckets_size; ++b) {
+      if (begins[b + 1] - begins[b] != 1) {
+        continue;
+      }
+      while (ph.slots[free_slot] != empty) {
+        ++free_slot;
+      }
+      ph.slots[free_slot] = grouped[begins[b]];
+      ph.seeds[b] = -static_cast<std::int64_t>(free_slot) - 1;
+    }
+    return ph;
+  }
+
+  static constexpr auto dense = make_dense();
+  static constexpr auto sorted = make_sorted();
+  static constexpr auto perfect_hash = make_hash();
+  static constexpr auto sorted_names = make_sorted_names();
+
+  static constexpr std::string_view to_string(E e) {
+    auto v = static_cast<long long>(static_cast<underlying>(e));
+    if constexpr (N == 0) {
+      return {};
+    } else if constexpr (is_dense) {
+      if (v < min || offset(v) >= range) {
+        return {};
+      }
+      return dense[offset(v)];
+    } else {
+      std::size_t first = 0;
+      std::size_t count = N;
+      while (count > 0) {
+        auto step = count / 2;
+        if (value(sorted[first + step]) < v) {
+          first += step + 1;
+          count -= step + 1;
+        } else {
+          count = step;
+        }
+      }
+      return first < N && value(sorted[first]) == v ? names[sorted[first]]
+                                                    : std::string_view{};
+    }
+  }
+
+  static constexpr std::optional<E> from_string(std::string_view name) {
+    if constexpr (N == 0) {
+      return std::nullopt;
+    } else if constexpr (!perfect_hash.ok) {
+      std::size_t first = 0;
+      std::size_t count = N;
+      while (count > 0) {
+        auto step = count / 2;
+        if (names[sorted_names[first + step]] < name) {
+          first += step + 1;
+          count -= step + 1;
+        } else {
+          count = step;
+        }
+      }
+      if (first < N && names[sorted_names[first]] == name) {
+        return constants[sorted_names[first]];
+      }
+      return std::nullopt;
+    } else {
+      auto seed = perfect_hash.seeds[hash(name, 0) & (buckets_size - 1)];
+      auto slot =
+          seed < 0 ? static_cast<std::size_t>(-seed - 1)
+                   : hash(name, static_cast<std::uint32_t>(seed)) &
+                         (slots_size - 1);
+      auto i = perfect_hash.slots[slot];
+      if (i == empty || names[i] != name) {
+        return std::nullopt;
+      }
+      return constants[i];
+    }
+  }
+};
+}  // namespace helper
+
+/**
+ * Name of the enumerator with the value, empty if there is none
+ */
+template <class E>
+constexpr std::string_view enum_to_string(E e) {
+  return helper::EnumStrings<E>::to_string(e);
+}
+
+/**
+ * Enumerator with the name if there is one
+ */
+template <class E>
+constexpr std::optional<E> enum_from_string(std::string_view name) {
+  return helper::EnumStrings<E>::from_string(name);
+}
 }  // namespace reflect
 
 template <typename T>
@@ -0,0 +1,272 @@
+#ifndef REFLECT_SERIALIZE_H
+#define REFLECT_SERIALIZE_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <reflect.hpp>
+
+/**
+ * Binary serialization used by the generated Reflect<T>::serialize and
+ * Reflect<T>::deserialize
+ *
+ * The format is the in memory representation of the trivially copyable
+ * members without padding, strings and vectors are prefixed with their
+ * length as uint64_t, so it is only meant to be read on the same platform.
+ * Pointers are never written.
+ */
+namespace reflect::serial {
+class Writer {
+  std::string& out;
+
+ public:
+  explicit Writer(std::string& out) : out{out} {}
+
+  void write(void const* data, std::size_t size) {
+    out.append(static_cast<char const*>(data), size);
+  }
+};
+
+class Reader {
+  std::string_view in;
+  bool ok = true;
+
+ public:
+  explicit Reader(std::string_view in) : in{in} {}
+
+  /**
+   * Read size bytes into data, on a short input nothing is read
+   * and the reader stays failed
+   */
+  bool read(void* data, std::size_t size) {
+    if (!ok || size > in.size()) {
+      ok = false;
+      return false;
+    }
+
+    std::memcpy(data, in.data(), size);
+    in.remove_prefix(size);
+    return true;
+  }
+
+  std::size_t remaining() const { return in.size(); }
+
+  void fail() { ok = false; }
+
+  bool good() const { return ok; }
+};
+
+template <class T>
+void write(Writer& w, T const& v);
+
+template <class T>
+void read(Reader& r, T& v);
+
+namespace helper {
+template <class T>
+struct is_vector : std::false_type {};
+
+template <class T, class A>
+struct is_vector<std::vector<T, A>> : std::true_type {};
+
+template <class T, class = void>
+struct has_serializer : std::false_type {};
+
+template <class T>
+struct has_serializer<T, std::void_t<decltype(Reflect<T>::serialize(
+                             std::declval<Writer&>(), std::declval<T const&>()))>>
+    : std::true_type {};
+
+/**
+ * Copied as is, only when every byte is part of the value so no padding
+ * is written, floats and doubles have no padding but -0 and +0 differ
+ */
+template <class T>
+constexpr bool is_bulk_v =
+    std::is_trivially_copyable_v<T> && !std::is_pointer_v<T> &&
+    !std::is_member_pointer_v<T> && !has_serializer<T>::value &&
+    (std::has_unique_object_representations_v<T> ||
+     std::is_same_v<T, float> || std::is_same_v<T, double>);
+
+template <class M>
+struct member;
+
+template <class C, class T>
+struct member<T C::*> {
+  using type = T;
+};
+
+template <auto M>
+using member_t = typename member<decltype(M)>::type;
+
+/**
+ * Check if the members are laid out one after the other without padding,
+ * the offsets are constants so this is folded by the optimizer
+ */
+template <auto... Ms, class T>
+bool is_contiguous(T const& v) {
+  char const* begins[] = {reinterpret_cast<char const*>(&(v.*Ms))...};
+  std::size_t sizes[] = {sizeof(member_t<Ms>)...};
+  for (std::size_t i = 1; i < sizeof...(Ms); ++i) {
+    if (begins[i - 1] + sizes[i - 1] != begins[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+inline bool read_size(Reader& r, std::uint64_t& size,
+                      std::size_t element_size) {
+  if (!r.read(&size, sizeof(size))) {
+    return false;
+  }
+
+  // NOTE: guard against allocating a corrupted size
+  if (size > r.remaining() / element_size) {
+    r.fail();
+    return false;
+  }
+  return true;
+}
+}  // namespace helper
+
+/**
+ * Write a run of data members with one memcpy when they are all
+ * trivially copyable and contiguous, member by member otherwise
+ */
+template <auto... Ms, class T>
+void write_run(Writer& w, T const& v) {
+  if constexpr ((helper::is_bulk_v<helper::member_t<Ms>> && ...)) {
+    if (helper::is_contiguous<Ms...>(v)) {
+      constexpr std::size_t size = (sizeof(helper::member_t<Ms>) + ...);
+      w.write(&(v.*reflect::helper::get<0>(value_list<Ms...>{})), size);
+      return;
+    }
+  }
+
+  (write(w, v.*Ms), ...);
+}
+
+template <auto... Ms, class T>
+void read_run(Reader& r, T& v) {
+  if constexpr ((helper::is_bulk_v<helper::member_t<Ms>> && ...)) {
+    if (helper::is_contiguous<Ms...>(v)) {
+      constexpr std::size_t size = (sizeof(helper::member_t<Ms>) + ...);
+      r.read(&(v.*reflect::helper::get<0>(value_list<Ms...>{})), size);
+      return;
+    }
+  }
+
+  (read(r, v.*Ms), ...);
+}
+
+template <class T>
+void write(Writer& w, T const& v) {
+  if constexpr (helper::is_bulk_v<T>) {
+    w.write(&v, sizeof(T));
+  } else if constexpr (helper::has_serializer<T>::value) {
+    Reflect<T>::serialize(w, v);
+  } else if constexpr (std::is_same_v<T, std::string>) {
+    std::uint64_t size = v.size();
+    w.write(&size, sizeof(size));
+    w.write(v.data(), v.size());
+  } else if constexpr (std::is_same_v<T, std::vector<bool>>) {
+    // NOTE: packed, so there is no data() to copy from
+    std::uint64_t size = v.size();
+    w.write(&size, sizeof(size));
+    for (bool b : v) {
+      char c = b;
+      w.write(&c, 1);
+    }
+  } else if constexpr (helper::is_vector<T>::value) {
+    using Element = typename T::value_type;
+    std::uint64_t size = v.size();
+    w.write(&size, sizeof(size));
+    if constexpr (helper::is_bulk_v<Element>) {
+      w.write(v.data(), v.size() * sizeof(Element));
+    } else {
+      for (auto& e : v) {
+        write(w, e);
+      }
+    }
+  } else {
+    static_assert(sizeof(T) == 0, "type has no generated serializer");
+  }
+}
+
+template <class T>
+void read(Reader& r, T& v) {
+  if constexpr (helper::is_bulk_v<T>) {
+    r.read(&v, sizeof(T));
+  } else if constexpr (helper::has_serializer<T>::value) {
+    Reflect<T>::deserialize(r, v);
+  } else if constexpr (std::is_same_v<T, std::string>) {
+    std::uint64_t size;
+    if (helper::read_size(r, size, 1)) {
+      v.resize(size);
+      r.read(v.data(), size);
+    }
+  } else if constexpr (std::is_same_v<T, std::vector<bool>>) {
+    std::uint64_t size;
+    if (!helper::read_size(r, size, 1)) {
+      return;
+    }
+
+    v.resize(size);
+    for (std::size_t i = 0; i < size; ++i) {
+      char c = 0;
+      r.read(&c, 1);
+      v[i] = c != 0;
+    }
+  } else if constexpr (helper::is_vector<T>::value) {
+    using Element = typename T::value_type;
+    // NOTE: a serialized object takes at least one byte
+    constexpr std::size_t element_size =
+        helper::is_bulk_v<Element> ? sizeof(Element) : 1;
+    std::uint64_t size;
+    if (!helper::read_size(r, size, element_size)) {
+      return;
+    }
+
+    v.resize(size);
+    if constexpr (helper::is_bulk_v<Element>) {
+      r.read(v.data(), size * sizeof(Element));
+    } else {
+      for (auto& e : v) {
+        if (!r.good()) {
+          return;
+        }
+        read(r, e);
+      }
+    }
+  } else {
+    static_assert(sizeof(T) == 0, "type has no generated serializer");
+  }
+}
+
+/**
+ * Append the serialized object to out
+ */
+template <class T>
+void serialize(std::string& out, T const& v) {
+  Writer w{out};
+  write(w, v);
+}
+
+/**
+ * Read the object from in, returns false if in is too short
+ */
+template <class T>
+bool deserialize(std::string_view in, T& v) {
+  Reader r{in};
+  read(r, v);
+  return r.good();
+}
+}  // namespace reflect::serial
+
+#endif  // REFLECT_SERIALIZE_H
@@ -0,0 +1,426 @@
+#ifndef REFLECT_SOA_VECTOR_H
+#define REFLECT_SOA_VECTOR_H
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include <reflect.hpp>
+
+/**
+ * Structure of arrays container of a reflected class, each data member is
+ * kept in its own contiguous array so loops over a few of the members only
+ * read those arrays and can be vectorized
+ *
+ * The elements are reached through proxy references, the columns and the
+ * members of a reference are also reachable by their names when the
+ * reflection was generated with the soa_members accessors
+ */
+namespace reflect {
+template <class T>
+class soa_vector;
+
+/**
+ * View over the array of one data member
+ */
+template <class M>
+class soa_column {
+  M* first;
+  std::size_t count;
+
+ public:
+  soa_column(M* first, std::size_t count) : first{first}, count{count} {}
+
+  M* data() const { return first; }
+  std::size_t size() const { return count; }
+  M* begin() const { return first; }
+  M* end() const { return first + count; }
+  M& operator[](std::size_t i) const { return first[i]; }
+};
+
+namespace helper {
+template <class M>
+struct member_pointer;
+
+template <class C, class M>
+struct member_pointer<M C::*> {
+  using type = M;
+};
+
+template <class T>
+constexpr std::size_t soa_size_v =
+    get_size_v<std::decay_t<decltype(Reflect<T>::data_members)>>;
+
+template <class T, std::size_t I>
+using soa_member_t = typename member_pointer<
+    std::decay_t<decltype(get<I>(Reflect<T>::data_members))>>::type;
+
+template <class T, std::size_t I>
+constexpr auto soa_pointer() {
+  return get<I>(Reflect<T>::data_members);
+}
+
+template <auto A, class B>
+constexpr bool soa_same(B b) {
+  if constexpr (std::is_same_v<decltype(A), B>) {
+    return A == b;
+  } else {
+    return false;
+  }
+}
+
+/**
+ * Index of the data member Ptr points to, the number of data members
+ * if it is not reflected
+ */
+template <class T, auto Ptr, std::size_t... Is>
+constexpr std::size_t soa_index(std::index_sequence<Is...>) {
+  std::size_t index = sizeof...(Is);
+  ((index = soa_same<Ptr>(soa_pointer<T, Is>()) ? Is : index), ...);
+  return index;
+}
+
+struct soa_no_members {};
+
+template <class T, class Self, class = void>
+struct soa_members {
+  using type = soa_no_members;
+};
+
+template <class T, class Self>
+struct soa_members<
+    T, Self, std::void_t<typename Reflect<T>::template soa_members<Self>>> {
+  using type = typename Reflect<T>::template soa_members<Self>;
+};
+
+template <class T, class Self>
+using soa_members_t = typename soa_members<T, Self>::type;
+}  // namespace helper
+
+/**
+ * Proxy reference to an element of a soa_vector, assigning to it
+ * assigns the members of the element
+ */
+template <class T, bool Const>
+class soa_reference
+    : public helper::soa_members_t<T, soa_reference<T, Const>> {
+  using Vector = std::conditional_t<Const, soa_vector<T> const, soa_vector<T>>;
+
+  Vector* vector;
+  std::size_t index;
+
+ public:
+  soa_reference(Vector& vector, std::size_t index)
+      : vector{&vector}, index{index} {}
+  soa_reference(soa_reference const&) = default;
+
+  template <std::size_t I>
+  auto& member() const {
+    return vector->template member<I>()[index];
+  }
+
+  template <auto Ptr>
+  auto& get() const {
+    return vector->template column<Ptr>()[index];
+  }
+
+  operator T() const { return vector->get(index); }
+
+  soa_reference const& operator=(T const& v) const {
+    static_assert(!Const, "assignment through a const reference");
+    vector->set(index, v);
+    return *this;
+  }
+
+  soa_reference const& operator=(soa_reference const& other) const {
+    return *this = static_cast<T>(other);
+  }
+
+  /**
+   * Swap the elements member by member, found through ADL by std::iter_swap
+   * so the algorithms that permute the elements work on the proxies
+   */
+  friend void swap(soa_reference a, soa_reference b) {
+    static_assert(!Const, "swap through a const reference");
+    a.swap_members(b, std::make_index_sequence<helper::soa_size_v<T>>{});
+  }
+
+ private:
+  template <std::size_t... Is>
+  void swap_members(soa_reference const& other,
+                    std::index_sequence<Is...>) const {
+    using std::swap;
+    (swap(member<Is>(), other.template member<Is>()), ...);
+  }
+};
+
+template <class T, bool Const>
+class soa_iterator {
+  using Vector = std::conditional_t<Const, soa_vector<T> const, soa_vector<T>>;
+
+  Vector* vector;
+  std::size_t index;
+
+ public:
+  using iterator_category = std::random_access_iterator_tag;
+  using value_type = T;
+  using difference_type = std::ptrdiff_t;
+  using reference = soa_reference<T, Const>;
+  using pointer = void;
+
+  soa_iterator(Vector& vector, std::size_t index)
+      : vector{&vector}, index{index} {}
+
+  reference operator*() const { return {*vector, index}; }
+  reference operator[](difference_type n) const {
+    return {*vector, index + n};
+  }
+
+  soa_iterator& operator++() {
+    ++index;
+    return *this;
+  }
+  soa_iterator operator++(int) {
+    auto old = *this;
+    ++index;
+    return old;
+  }
+  soa_iterator& operator--() {
+    --index;
+    return *this;
+  }
+  soa_iterator operator--(int) {
+    auto old = *this;
+    --index;
+    return old;
+  }
+  soa_iterator& operator+=(difference_type n) {
+    index += n;
+    return *this;
+  }
+  soa_iterator& operator-=(difference_type n) {
+    index -= n;
+    return *this;
+  }
+  soa_iterator operator+(difference_type n) const {
+    return {*vector, index + n};
+  }
+  friend soa_iterator operator+(difference_type n, soa_iterator const& it) {
+    return it + n;
+  }
+  soa_iterator operator-(difference_type n) const {
+    return {*vector, index - n};
+  }
+  difference_type operator-(soa_iterator const& other) const {
+    return static_cast<difference_type>(index) -
+           static_cast<difference_type>(other.index);
+  }
+
+  bool operator==(soa_iterator const& other) const {
+    return index == other.index;
+  }
+  bool operator!=(soa_iterator const& other) const {
+    return index != other.index;
+  }
+  bool operator<(soa_iterator const& other) const {
+    return index < other.index;
+  }
+  bool operator>(soa_iterator const& other) const {
+    return index > other.index;
+  }
+  bool operator<=(soa_iterator const& other) const {
+    return index <= other.index;
+  }
+  bool operator>=(soa_iterator const& other) const {
+    return index >= other.index;
+  }
+};
+
+template <class T>
+class soa_vector : public helper::soa_members_t<T, soa_vector<T>> {
+  static constexpr std::size_t N = helper::soa_size_v<T>;
+  using Indices = std::make_index_sequence<N>;
+
+  template <std::size_t... Is>
+  static auto make_columns(std::index_sequence<Is...>)
+      -> std::tuple<std::unique_ptr<helper::soa_member_t<T, Is>[]>...>;
+
+  // NOTE: all the columns share the size and the capacity
+  decltype(make_columns(Indices{})) columns;
+  std::size_t count = 0;
+  std::size_t capacity_ = 0;
+
+  template <std::size_t... Is>
+  void grow(std::size_t new_capacity, std::index_sequence<Is...>) {
+    (grow_column<Is>(new_capacity), ...);
+    capacity_ = new_capacity;
+  }
+
+  template <std::size_t I>
+  void grow_column(std::size_t new_capacity) {
+    using M = helper::soa_member_t<T, I>;
+    std::unique_ptr<M[]> column{new M[new_capacity]};
+    auto& old = std::get<I>(columns);
+    std::move(old.get(), old.get() + count, column.get());
+    old = std::move(column);
+  }
+
+  template <std::size_t... Is>
+  void set(std::size_t i, T const& v, std::index_sequence<Is...>) {
+    ((std::get<Is>(columns)[i] = v.*helper::soa_pointer<T, Is>()), ...);
+  }
+
+  template <std::size_t... Is>
+  void set(std::size_t i, T&& v, std::index_sequence<Is...>) {
+    ((std::get<Is>(columns)[i] =
+          std::move(v.*helper::soa_pointer<T, Is>())),
+     ...);
+  }
+
+  template <std::size_t... Is>
+  void get(std::size_t i, T& v, std::index_sequence<Is...>) const {
+    ((v.*helper::soa_pointer<T, Is>() = std::get<Is>(columns)[i]), ...);
+  }
+
+  /**
+   * Reset the elements in [from, to) to release what they hold
+   */
+  template <std::size_t... Is>
+  void reset(std::size_t from, std::size_t to, std::index_sequence<Is...>) {
+    (std::fill(std::get<Is>(columns).get() + from,
+               std::get<Is>(columns).get() + to, helper::soa_member_t<T, Is>{}),
+     ...);
+  }
+
+  template <std::size_t... Is>
+  void copy(soa_vector const& other, std::index_sequence<Is...>) {
+    (std::copy(std::get<Is>(other.columns).get(),
+               std::get<Is>(other.columns).get() + other.count,
+               std::get<Is>(columns).get()),
+     ...);
+  }
+
+ public:
+  using value_type = T;
+  using size_type = std::size_t;
+  using reference = soa_reference<T, false>;
+  using const_reference = soa_reference<T, true>;
+  using iterator = soa_iterator<T, false>;
+  using const_iterator = soa_iterator<T, true>;
+
+  soa_vector() = default;
+
+  soa_vector(soa_vector const& other) {
+    reserve(other.count);
+    copy(other, Indices{});
+    count = other.count;
+  }
+
+  soa_vector(soa_vector&& other) noexcept
+      : columns{std::move(other.columns)},
+        count{std::exchange(other.count, 0)},
+        capacity_{std::exchange(other.capacity_, 0)} {}
+
+  soa_vector& operator=(soa_vector other) noexcept {
+    std::swap(columns, other.columns);
+    std::swap(count, other.count);
+    std::swap(capacity_, other.capacity_);
+    return *this;
+  }
+
+  std::size_t size() const { return count; }
+  std::size_t capacity() const { return capacity_; }
+  bool empty() const { return count == 0; }
+
+  void reserve(std::size_t n) {
+    if (n > capacity_) {
+      grow(n, Indices{});
+    }
+  }
+
+  void resize(std::size_t n) {
+    reserve(n);
+    // NOTE: new columns are default initialized
+    reset(std::min(n, count), std::max(n, count), Indices{});
+    count = n;
+  }
+
+  void clear() { resize(0); }
+
+  void push_back(T const& v) {
+    if (count == capacity_) {
+      grow(std::max<std::size_t>(1, 2 * capacity_), Indices{});
+    }
+    set(count, v, Indices{});
+    ++count;
+  }
+
+  void push_back(T&& v) {
+    if (count == capacity_) {
+      grow(std::max<std::size_t>(1, 2 * capacity_), Indices{});
+    }
+    set(count, std::move(v), Indices{});
+    ++count;
+  }
+
+  void pop_back() {
+    reset(count - 1, count, Indices{});
+    --count;
+  }
+
+  /**
+   * Assemble a copy of the element
+   */
+  T get(std::size_t i) const {
+    T v;
+    get(i, v, Indices{});
+    return v;
+  }
+
+  void set(std::size_t i, T const& v) { set(i, v, Indices{}); }
+
+  /**
+   * The array of the I-th data member in declaration order
+   */
+  template <std::size_t I>
+  soa_column<helper::soa_member_t<T, I>> member() {
+    return {std::get<I>(columns).get(), count};
+  }
+
+  template <std::size_t I>
+  soa_column<helper::soa_member_t<T, I> const> member() const {
+    return {std::get<I>(columns).get(), count};
+  }
+
+  /**
+   * The array of the data member Ptr points to, e.g. column<&T::x>()
+   */
+  template <auto Ptr>
+  auto column() {
+    constexpr auto I = helper::soa_index<T, Ptr>(Indices{});
+    static_assert(I < N, "not a reflected data member");
+    return member<I>();
+  }
+
+  template <auto Ptr>
+  auto column() const {
+    constexpr auto I = helper::soa_index<T, Ptr>(Indices{});
+    static_assert(I < N, "not a reflected data member");
+    return member<I>();
+  }
+
+  reference operator[](std::size_t i) { return {*this, i}; }
+  const_reference operator[](std::size_t i) const { return {*this, i}; }
+
+  iterator begin() { return {*this, 0}; }
+  iterator end() { return {*this, count}; }
+  const_iterator begin() const { return {*this, 0}; }
+  const_iterator end() const { return {*this, count}; }
+};
+}  // namespace reflect
+
+#endif  // REFLECT_SOA_VECTOR_H
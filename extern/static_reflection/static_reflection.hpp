@@ -1,11 +1,21 @@
 #ifndef STATIC_REFLECTION_H
 #define STATIC_REFLECTION_H
 
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_set>
 #include <variant>
+#include <vector>
 
 #include <boost/spirit/home/x3.hpp>
 
 #include <result.hpp>
+#include <source_loader.hpp>
 #include <std_ast.hpp>
 #include <std_helpers.hpp>
 
@@ -32,6 +42,78 @@ BOOST_SPIRIT_DEFINE(optionaly_space, scope_end, reflexpr);
 
 namespace helper = std_parser::rules::ast;
 
+/**
+ * The unqualified name of a type without template arguments
+ * i.e. ns::A<int> -> A
+ */
+inline std::string simple_name(std::string_view type) {
+  type = type.substr(0, type.find('<'));
+  if (auto scope = type.rfind("::"); scope != std::string_view::npos) {
+    type.remove_prefix(scope + 2);
+  }
+
+  auto is_space = [](char c) { return c == ' ' || c == '\t' || c == '\n'; };
+  while (!type.empty() && is_space(type.front())) {
+    type.remove_prefix(1);
+  }
+  while (!type.empty() && is_space(type.back())) {
+    type.remove_suffix(1);
+  }
+  return std::string{type};
+}
+
+/**
+ * The path as a single file name
+ */
+inline std::string flat_file_name(std::string_view path) {
+  std::string name{path};
+  std::replace_if(
+      name.begin(), name.end(),
+      [](char c) { return c == '/' || c == '\\' || c == ':'; }, '_');
+  return name;
+}
+
+/**
+ * The file in the shared reflection dir with the reflection of the types
+ * declared in the header
+ */
+inline fs::path shared_reflection_path(fs::path const& dir,
+                                       std::string_view header) {
+  return dir / "headers" / (flat_file_name(header) + ".hpp");
+}
+
+/**
+ * The file in the shared reflection dir listing the headers of the source
+ * with their reflection
+ *
+ * NOTE: keyed on the full path of the source, CMake computes the same name
+ */
+inline fs::path shared_sources_path(fs::path const& dir,
+                                    std::string_view source) {
+  return dir / "sources" / (flat_file_name(source) + ".hpp");
+}
+
+/**
+ * Read the names of the types to reflect from all the files in the dir,
+ * each written by a StaticReflexParser collecting them for one source
+ */
+inline std::unordered_set<std::string> read_reflected_types(
+    fs::path const& dir) {
+  std::unordered_set<std::string> types;
+  if (!fs::is_directory(dir)) {
+    return types;
+  }
+
+  for (auto& entry : fs::directory_iterator(dir)) {
+    std::ifstream in(entry.path());
+    std::string name;
+    while (std::getline(in, name)) {
+      types.insert(std::move(name));
+    }
+  }
+  return types;
+}
+
 template <class Parent>
 class StaticReflexParser {
   using Namespace = std_parser::rules::ast::Namespace;
@@ -98,36 +180,491 @@ class StaticReflexParser {
     }
   }
 
-  public:
-  // TODO: generate reflection for the current class
+  /**
+   * Append the opening of a pack of values, the constant should be closed
+   * with close_values
+   */
+  void open_values(std::string& out, std::string_view constant) {
+    if (representation == Representation::Flat) {
+      out += "constexpr inline static reflect::value_list<";
+    } else {
+      out += "constexpr inline static auto ";
+      out += constant;
+      out += " = std::make_tuple(";
+    }
+  }
+
+  void close_values(std::string& out, std::string_view constant) {
+    if (representation == Representation::Flat) {
+      out += "> ";
+      out += constant;
+      out += "{};\n";
+    } else {
+      out += ");\n";
+    }
+  }
+
+  /**
+   * Append the opening of an array of count elements of the type,
+   * the constant should be closed with close_array
+   */
+  void open_array(std::string& out, std::string_view constant,
+                  std::string_view type, std::size_t count) {
+    if (representation == Representation::Flat) {
+      out += "constexpr inline static std::array<";
+      out += type;
+      out += ", ";
+      out += std::to_string(count);
+      out += "> ";
+      out += constant;
+      out += "{{";
+    } else {
+      out += "constexpr inline static auto ";
+      out += constant;
+      out += " = std::make_tuple(";
+    }
+  }
+
+  void close_array(std::string& out) {
+    out += representation == Representation::Flat ? "}};\n" : ");\n";
+  }
+
+  /**
+   * Append the opening of a type pack, closed with close_types
+   */
+  void open_types(std::string& out, std::string_view alias) {
+    out += "using ";
+    out += alias;
+    out += representation == Representation::Flat ? " = reflect::type_list<"
+                                                  : " = std::tuple<";
+  }
+
+  void close_types(std::string& out) { out += ">;\n"; }
+
+  /**
+   * Append the member layout tables, they are only instantiated when used
+   * as offsetof is only valid for standard layout classes
+   */
+  void append_layout(std::string& out, std::vector<var> const& data_members,
+                     std::string_view class_name,
+                     std::string_view class_templates) {
+    auto append_table = [&](std::string_view type, std::string_view table,
+                            std::string_view before, std::string_view after) {
+      out += "constexpr inline static std::array<";
+      out += type;
+      out += ", ";
+      out += std::to_string(data_members.size());
+      out += "> ";
+      out += table;
+      out += "{{";
+      for (auto& m : data_members) {
+        out += before;
+        out += m.name;
+        out += after;
+        out += ',';
+      }
+      if (!data_members.empty()) {
+        out.pop_back();
+      }
+      out += "}};\n";
+    };
+
+    out += "template <class Self = ";
+    out += class_name;
+    out += class_templates;
+    out += "> struct layout {\n";
+    out +=
+        "static_assert(std::is_standard_layout_v<Self>, \"member layout is "
+        "only available for standard layout classes\");\n";
+    append_table("std::size_t", "offsets", "offsetof(Self, ", ")");
+    append_table("std::size_t", "sizes", "sizeof(std::declval<Self>().", ")");
+    append_table("reflect::TypeId", "type_ids",
+                 "reflect::type_id_v<decltype(std::declval<Self>().", ")>");
+    out += "};\n";
+  }
+
+  /**
+   * Check if the member's type is spelled as an arithmetic type,
+   * runs of those are serialized with a single write
+   */
+  static bool is_plain(var const& m) {
+    static std::string_view const plain[] = {
+        "bool",          "char",          "short",         "int",
+        "long",          "unsigned",      "float",         "double",
+        "size_t",        "int8_t",        "uint8_t",       "int16_t",
+        "uint16_t",      "int32_t",       "uint32_t",      "int64_t",
+        "uint64_t",      "std::size_t",   "std::int8_t",   "std::uint8_t",
+        "std::int16_t",  "std::uint16_t", "std::int32_t",  "std::uint32_t",
+        "std::int64_t",  "std::uint64_t"};
+    if (!m.type.right_qualifiers.empty()) {
+      return false;
+    }
+
+    auto type = helper::to_string(m.type.type);
+    return std::find(std::begin(plain), std::end(plain), type) !=
+           std::end(plain);
+  }
+
+  /**
+   * Split the members into runs of plain members and single members
+   * of any other type
+   */
+  static std::vector<std::vector<var const*>> plain_runs(
+      std::vector<var> const& data_members) {
+    std::vector<std::vector<var const*>> runs;
+    bool in_run = false;
+    for (auto& m : data_members) {
+      bool plain = is_plain(m);
+      if (!plain || !in_run) {
+        runs.emplace_back();
+      }
+      runs.back().push_back(&m);
+      in_run = plain;
+    }
+    return runs;
+  }
+
+  /**
+   * Append serialize and deserialize functions that go over the members
+   * in runs of plain members and single members of any other type
+   * e.g. write_run<&S::a,&S::b>(w, v); write(w, v.s);
+   *
+   * NOTE: templates so they are only compiled when used, a class with a
+   * member that can't be serialized only fails if it is serialized
+   */
+  void append_serializers(std::string& out,
+                          std::vector<var> const& data_members,
+                          std::string_view class_name,
+                          std::string_view class_templates) {
+    std::string full_name{class_name};
+    full_name += class_templates;
+
+    auto runs = plain_runs(data_members);
+
+    auto append_body = [&](std::string_view run, std::string_view single,
+                           std::string_view stream) {
+      for (auto& r : runs) {
+        if (r.size() == 1) {
+          out += single;
+          out += '(';
+          out += stream;
+          out += ", v.";
+          out += r.front()->name;
+          out += ");\n";
+          continue;
+        }
+
+        out += run;
+        out += '<';
+        for (auto m : r) {
+          out += '&';
+          out += full_name;
+          out += "::";
+          out += m->name;
+          out += ',';
+        }
+        out.back() = '>';
+        out += '(';
+        out += stream;
+        out += ", v);\n";
+      }
+    };
+
+    out += "template <class SerialWriter = reflect::serial::Writer>\n";
+    out += "static void serialize(SerialWriter& w, ";
+    out += full_name;
+    out += " const& v) {\n";
+    append_body("reflect::serial::write_run", "reflect::serial::write", "w");
+    out += "}\n";
+
+    out += "template <class SerialReader = reflect::serial::Reader>\n";
+    out += "static void deserialize(SerialReader& r, ";
+    out += full_name;
+    out += "& v) {\n";
+    append_body("reflect::serial::read_run", "reflect::serial::read", "r");
+    out += "}\n";
+  }
+
+  /**
+   * Append equal, compare and hash functions that go over the members in
+   * declaration order, the hash goes over runs of plain members
+   * e.g. h = hash_run<&S::a,&S::b>(h, v);
+   *
+   * NOTE: templates removed from overload resolution when a member doesn't
+   * support the operation, a class with e.g. an unordered_map member still
+   * compiles and only its ordering and hash are missing
+   */
+  void append_comparisons(std::string& out,
+                          std::vector<var> const& data_members,
+                          std::string_view class_name,
+                          std::string_view class_templates) {
+    std::string full_name{class_name};
+    full_name += class_templates;
+
+    auto append_header = [&](std::string_view trait) {
+      out += "template <class Self = ";
+      out += full_name;
+      out += ", class = std::enable_if_t<reflect::cmp::";
+      out += trait;
+      out += '<';
+      for (auto& m : data_members) {
+        out += "decltype(std::declval<Self const&>().";
+        out += m.name;
+        out += "),";
+      }
+      if (!data_members.empty()) {
+        out.pop_back();
+      }
+      out += ">>>\n";
+    };
+
+    append_header("equality_comparable_v");
+    out += "static bool equal(Self const& a, Self const& b) {\nreturn ";
+    for (auto& m : data_members) {
+      out += "a.";
+      out += m.name;
+      out += " == b.";
+      out += m.name;
+      out += " && ";
+    }
+    out += "true;\n}\n";
+
+    append_header("comparable_v");
+    out += "static int compare(Self const& a, Self const& b) {\n";
+    for (auto& m : data_members) {
+      out += "if (int c = reflect::cmp::compare(a.";
+      out += m.name;
+      out += ", b.";
+      out += m.name;
+      out += ")) { return c; }\n";
+    }
+    out += "return 0;\n}\n";
+
+    append_header("hashable_v");
+    out += "static std::size_t hash(Self const& v) {\nstd::size_t h = 0;\n";
+    for (auto& r : plain_runs(data_members)) {
+      if (r.size() == 1) {
+        out += "h = reflect::cmp::combine(h, reflect::cmp::hash_value(v.";
+        out += r.front()->name;
+        out += "));\n";
+        continue;
+      }
+
+      out += "h = reflect::cmp::hash_run<";
+      for (auto m : r) {
+        out += '&';
+        out += full_name;
+        out += "::";
+        out += m->name;
+        out += ',';
+      }
+      out.back() = '>';
+      out += "(h, v);\n";
+    }
+    out += "return reflect::cmp::mix(h);\n}\n";
+  }
+
+  /**
+   * Check if the class declares the method
+   */
+  static bool declares(Class& c, std::string_view name) {
+    for (auto* methods : {&c.public_methods, &c.protected_methods,
+                          &c.private_methods, &c.unspecified_methods}) {
+      for (auto& f : *methods) {
+        if (f.name == name) {
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  /**
+   * Append the comparison operators and the std::hash specialization
+   * forwarding to the generated functions, the operators the class
+   * declares itself are skipped
+   *
+   * NOTE: templates on a defaulted Self so their bodies are only compiled
+   * when used, they take the class itself so conversions still apply
+   */
+  void append_operators(std::string& out, Class& c,
+                        std::string_view template_header,
+                        std::string_view full_name) {
+    std::string header{"template <"};
+    if (c.is_templated()) {
+      header = template_header.substr(0, template_header.size() - 1);
+      header += ", ";
+    }
+    header += "class Self = ";
+    header += full_name;
+    header += '>';
+
+    auto append_operator = [&](std::string_view op, std::string_view trait,
+                               std::string_view body) {
+      if (declares(c, std::string{"operator"} + std::string{op})) {
+        return;
+      }
+      out += '\n';
+      out += header;
+      out += " inline std::enable_if_t<reflect::cmp::helper::";
+      out += trait;
+      out += "<Self>::value, bool> operator";
+      out += op;
+      out += '(';
+      out += full_name;
+      out += " const& a, ";
+      out += full_name;
+      out += " const& b) { return ";
+      out += body;
+      out += "; }";
+    };
+
+    // NOTE: in the shared header the operators are reopened in the
+    // namespaces of the type so that ADL still finds them
+    for (auto& name : shared_namespaces) {
+      out += "\nnamespace " + name + " {";
+    }
+    std::string meta = "reflect::Reflect<Self>";
+    append_operator("==", "has_equal", meta + "::equal(a, b)");
+    append_operator("!=", "has_equal", "!" + meta + "::equal(a, b)");
+    append_operator("<", "has_compare", meta + "::compare(a, b) < 0");
+    append_operator(">", "has_compare", meta + "::compare(a, b) > 0");
+    append_operator("<=", "has_compare", meta + "::compare(a, b) <= 0");
+    append_operator(">=", "has_compare", meta + "::compare(a, b) >= 0");
+    if (!shared_namespaces.empty()) {
+      out += '\n';
+      out += std::string(shared_namespaces.size(), '}');
+    }
+
+    out += '\n';
+    out += template_header;
+    out += " struct std::hash<";
+    out += full_name;
+    out += "> { ";
+    out += "template <class Self = ";
+    out += full_name;
+    out += "> std::enable_if_t<reflect::cmp::helper::has_hash<Self>::value, "
+           "std::size_t> operator()(";
+    out += full_name;
+    out += " const& v) const { return ";
+    out += meta;
+    out += "::hash(v); } };";
+  }
+
+  /**
+   * Append accessors named after the data members for reflect::soa_vector
+   * and its references, forwarding to Soa::member<index>()
+   */
+  void append_soa_members(std::string& out,
+                          std::vector<var> const& data_members) {
+    out += "template <class Soa> struct soa_members {\n";
+    for (std::size_t i = 0; i < data_members.size(); ++i) {
+      auto index = std::to_string(i);
+      auto& name = data_members[i].name;
+      out += "decltype(auto) ";
+      out += name;
+      out += "() { return static_cast<Soa*>(this)->template member<";
+      out += index;
+      out += ">(); }\n";
+      out += "decltype(auto) ";
+      out += name;
+      out += "() const { return static_cast<Soa const*>(this)->template member<";
+      out += index;
+      out += ">(); }\n";
+    }
+    out += "};\n";
+  }
+
+  /**
+   * Nested class templates and specializations are not reflected
+   */
+  static bool is_reflectable_nested(Class& c) {
+    return !c.is_templated() && c.specialization.template_types.empty();
+  }
+
+  /**
+   * Append friend declarations for the reflection of the nested classes
+   * and enums, named relative to the current class as prefix::name
+   */
+  void append_nested_friends(std::string& out, Class& c,
+                             std::string const& prefix) {
+    for (auto& [name, classes] : c.classes) {
+      for (auto& nested : classes) {
+        if (!is_reflectable_nested(nested)) {
+          continue;
+        }
+        out += "\nfriend reflect::Reflect<";
+        out += prefix;
+        out += nested.name;
+        out += ">;";
+        append_nested_friends(out, nested, prefix + nested.name + "::");
+      }
+    }
+
+    for (auto& [name, e] : c.enums) {
+      out += "\nfriend reflect::Reflect<";
+      out += prefix;
+      out += name;
+      out += ">;";
+    }
+  }
+
+  /**
+   * Append the reflection of the nested classes and enums of the class
+   * qualified as scope::name
+   */
+  void append_nested_reflection(std::string& out, Class& c,
+                                std::string const& scope) {
+    for (auto& [name, classes] : c.classes) {
+      for (auto& nested : classes) {
+        if (is_reflectable_nested(nested)) {
+          out += '\n';
+          append_reflection(out, nested, scope);
+        }
+      }
+    }
+
+    for (auto& [name, e] : c.enums) {
+      out += '\n';
+      append_reflection(out, e, scope);
+    }
+  }
+
+  /**
+   * Check if the reflection of the type is needed, all types are
+   * unless only the types named in reflexpr are reflected
+   */
+  bool is_reflected(std::string const& name) {
+    return !reflected_types || reflected_types->count(name);
+  }
+
   // TODO: refactor this method extract to shorter ones
-  auto generate_reflection(Class& c) {
-    std::string out;
-    out.reserve(300);
-    out += "\nfriend reflect::Reflect<";
-    out += c.name;
-    out += ">;\n};\n";
+  void append_reflection(std::string& out, Class& c, std::string const& scope) {
+    auto qualified_name = scope + c.name;
+    if (!is_reflected(c.name)) {
+      append_nested_reflection(out, c, qualified_name + "::");
+      return;
+    }
 
+    std::string template_header = "template <";
     if (c.is_templated()) {
-      out += "template <";
       for (auto& tmp : c.template_parameters.value()) {
         for (auto& s : tmp.type) {
-          out += s;
-          out += "::";
+          template_header += s;
+          template_header += "::";
         }
-        out.pop_back();
-        out.pop_back();
-        out += ' ';
-        out += tmp.name;
-        out += ',';
+        template_header.pop_back();
+        template_header.pop_back();
+        template_header += ' ';
+        template_header += tmp.name;
+        template_header += ',';
       }
-      out.pop_back();
-      out += '>';
-      out += " struct reflect::Reflect<";
-    } else {
-      out += "template <> struct reflect::Reflect<";
+      template_header.pop_back();
     }
-    out += c.name;
+    template_header += '>';
+    out += template_header;
+    out += " struct reflect::Reflect<";
+    out += qualified_name;
     std::string class_templates;
     if (c.is_templated()) {
       class_templates.reserve(50);
@@ -142,39 +679,51 @@ class StaticReflexParser {
     }
     out += "> {\n";
 
-    out +=
-        "constexpr inline static auto public_data_members = std::make_tuple(";
-    append_members(out, c.public_members, c.name, class_templates);
-    out += ");\n";
+    open_values(out, "public_data_members");
+    append_members(out, c.public_members, qualified_name, class_templates);
+    close_values(out, "public_data_members");
 
-    out +=
-        "constexpr inline static auto public_data_member_names = "
-        "std::make_tuple(";
+    open_array(out, "public_data_member_names", "const char*",
+               c.public_members.size());
     append_names(out, c.public_members);
-    out += ");\n";
+    close_array(out);
 
-    out += "using public_data_member_types = std::tuple<";
-    append_types(out, c.public_members, c.name, class_templates);
-    out += ">;\n";
+    open_types(out, "public_data_member_types");
+    append_types(out, c.public_members, qualified_name, class_templates);
+    close_types(out);
 
-    out += "constexpr inline static auto data_members = std::make_tuple(";
     auto data_members = c.public_members;
     data_members.insert(data_members.end(), c.protected_members.begin(),
                         c.protected_members.end());
     data_members.insert(data_members.end(), c.private_members.begin(),
                         c.private_members.end());
-    append_members(out, data_members, c.name, class_templates);
-    out += ");\n";
+    open_values(out, "data_members");
+    append_members(out, data_members, qualified_name, class_templates);
+    close_values(out, "data_members");
 
-    out += "constexpr inline static auto data_member_names = std::make_tuple(";
+    open_array(out, "data_member_names", "const char*", data_members.size());
     append_names(out, data_members);
-    out += ");\n";
+    close_array(out);
+
+    open_types(out, "data_member_types");
+    append_types(out, data_members, qualified_name, class_templates);
+    close_types(out);
 
-    out += "using data_member_types = std::tuple<";
-    append_types(out, data_members, c.name, class_templates);
-    out += ">;\n";
+    append_layout(out, data_members, qualified_name, class_templates);
 
-    out += "using public_base_classes = std::tuple<";
+    if (with_serializers) {
+      append_serializers(out, data_members, qualified_name, class_templates);
+    }
+
+    if (with_soa) {
+      append_soa_members(out, data_members);
+    }
+
+    if (with_comparisons) {
+      append_comparisons(out, data_members, qualified_name, class_templates);
+    }
+
+    open_types(out, "public_base_classes");
     for (auto& type : c.public_bases) {
       out += helper::to_string(type);
       out += ',';
@@ -183,13 +732,13 @@ class StaticReflexParser {
     if (!c.public_bases.empty()) {
       out.pop_back();
     }
-    out += ">;\n";
+    close_types(out);
     auto base_classes = c.public_bases;
     base_classes.insert(base_classes.end(), c.protected_bases.begin(),
                         c.protected_bases.end());
     base_classes.insert(base_classes.end(), c.private_bases.begin(),
                         c.private_bases.end());
-    out += "using base_classes = std::tuple<";
+    open_types(out, "base_classes");
     for (auto& type : base_classes) {
       out += helper::to_string(type);
       out += ',';
@@ -198,7 +747,7 @@ class StaticReflexParser {
     if (!base_classes.empty()) {
       out.pop_back();
     }
-    out += ">;\n";
+    close_types(out);
 
     out += "constexpr static auto name = \"";
     out += c.name;
@@ -219,21 +768,29 @@ class StaticReflexParser {
 
     out += "};";
 
-    return out;
+    if (with_comparisons) {
+      append_operators(out, c, template_header,
+                       qualified_name + class_templates);
+    }
+
+    append_nested_reflection(out, c, qualified_name + "::");
   }
 
-  auto generate_reflection(Enumeration& c) {
-    std::string out;
-    out.reserve(300);
-    out += "\n};\n template <> struct reflect::Reflect<";
-    out += c.name;
+  void append_reflection(std::string& out, Enumeration& c,
+                         std::string const& scope) {
+    auto qualified_name = scope + c.name;
+    if (!is_reflected(c.name)) {
+      return;
+    }
+    out += " template <> struct reflect::Reflect<";
+    out += qualified_name;
     out += ">{\n";
 
     out += "constexpr static auto name = \"";
     out += c.name;
     out += "\";\n";
 
-    out += "constexpr static auto enumerator_names = std::make_tuple(";
+    open_array(out, "enumerator_names", "const char*", c.enumerators.size());
     for (auto& e : c.enumerators) {
       out += '\"';
       out += e;
@@ -245,11 +802,12 @@ class StaticReflexParser {
       out.pop_back();
     }
 
-    out += ");\n";
+    close_array(out);
 
-    out += "constexpr static auto enumerator_constants = std::make_tuple(";
+    open_array(out, "enumerator_constants", qualified_name,
+               c.enumerators.size());
     for (auto& e : c.enumerators) {
-      out += c.name;
+      out += qualified_name;
       out += "::";
       out += e;
       out += ',';
@@ -259,7 +817,7 @@ class StaticReflexParser {
       out.pop_back();
     }
 
-    out += ");\n";
+    close_array(out);
 
     out += "static constexpr auto object_type = reflect::ObjectType::ENUM;\n";
 
@@ -274,34 +832,118 @@ class StaticReflexParser {
     if (!c.as.empty()) {
       out.pop_back();
       out.pop_back();
+    } else {
+      out += "std::underlying_type_t<";
+      out += qualified_name;
+      out += '>';
     }
     out += ';';
     out += '\n';
 
     out += "};";
+  }
+
+  public:
+  /**
+   * Generate the end of the class with the friend declarations, followed by
+   * the reflection of the class and its nested types for a class in a
+   * namespace, the enclosing class generates the reflection of nested ones
+   */
+  auto generate_reflection(Class& c, bool is_nested = false) {
+    std::string out;
+    out.reserve(300);
+    append_end_of_type(out, c);
+
+    if (!is_nested) {
+      append_reflection(out, c, "");
+    }
+
     return out;
   }
 
+  auto generate_reflection(Enumeration& c) {
+    std::string out;
+    out.reserve(300);
+    append_end_of_type(out, c);
+    append_reflection(out, c, "");
+    return out;
+  }
+
+  void append_end_of_type(std::string& out, Class& c) {
+    out += "\nfriend reflect::Reflect<";
+    out += c.name;
+    out += ">;";
+    append_nested_friends(out, c, "");
+    out += "\n};\n";
+  }
+
+  void append_end_of_type(std::string& out, Enumeration&) { out += "\n};\n"; }
+
   template <class Type, class V>
   bool is_(V v) {
     return std::holds_alternative<Type>(v);
   }
 
+  /**
+   * Check if the reflection of the current file goes to the shared header
+   */
+  bool shares_reflection() {
+    return !shared_reflection_dir.empty() &&
+           !source::is_source(parent.get_current_file_name());
+  }
+
+  /**
+   * The names of the namespaces enclosing the current code fragment, from
+   * the outermost one
+   */
+  std::vector<std::string> enclosing_namespaces() {
+    auto& std_parser = parent.template get_parser<Parent::std_parser_id>();
+    std::vector<std::string> names;
+    // NOTE: the first fragment is the global namespace
+    auto const& code_fragments = std_parser.get_all_code_fragments();
+    for (std::size_t i = 1; i < code_fragments.size(); ++i) {
+      if (auto n = std::get_if<Namespace>(&code_fragments[i])) {
+        names.push_back(n->get_name());
+      }
+    }
+    return names;
+  }
+
   template <class Type>
-  auto generate_reflection() {
+  auto generate_reflection(bool is_nested = false) {
     auto& std_parser = parent.template get_parser<Parent::std_parser_id>();
     auto& current_type = std::get<Type>(std_parser.get_current_code_fragment());
-    auto rez = generate_reflection(current_type);
+    std::string rez;
+    if (is_nested || !shares_reflection()) {
+      if constexpr (std::is_same_v<Type, Class>) {
+        rez = generate_reflection(current_type, is_nested);
+      } else {
+        rez = generate_reflection(current_type);
+      }
+    } else {
+      // NOTE: only the end of the type stays in the header
+      // the shared header is at global scope so the type is qualified
+      append_end_of_type(rez, current_type);
+      shared_namespaces = enclosing_namespaces();
+      std::string scope;
+      for (auto& name : shared_namespaces) {
+        scope += name + "::";
+      }
+      append_reflection(shared_reflection, current_type, scope);
+      shared_namespaces.clear();
+      shared_reflection += '\n';
+    }
     std_parser.template close_code_fragment<Type>();
     return rez;
   }
 
   // TODO: maybe use std::visit
   template <typename Iter>
-  auto get_reflection(Iter begin) {
+  auto get_reflection(Iter begin, bool is_nested) {
     auto& std_parser = parent.template get_parser<Parent::std_parser_id>();
     return is_<Class>(std_parser.get_current_code_fragment())
-               ? std::optional{Result{begin, generate_reflection<Class>()}}
+               ? std::optional{Result{begin,
+                                      generate_reflection<Class>(is_nested)}}
                : is_<Enumeration>(std_parser.get_current_code_fragment())
                      ? std::optional{Result{begin,
                                             generate_reflection<Enumeration>()}}
@@ -346,6 +988,7 @@ class StaticReflexParser {
         std::get<Expression>(std_parser.get_current_code_fragment());
     std_parser.open_new_code_fragment(RoundExpression{});
     in_reflexpr = true;
+    reflexpr_begin = &*it;
     return std::optional{Result{it, std::string{"reflexpr<"}}};
   }
 
@@ -357,15 +1000,45 @@ class StaticReflexParser {
     return std::optional{Result{it, std::string{">"}}};
   }
 
-  bool is_current_code_fragment_inside_namespace() {
+  /**
+   * Remember the bases of the class being closed,
+   * the bases of a reflected type are reflected too
+   */
+  void collect_bases(Class const& c) {
+    auto& bases = bases_of[c.name];
+    for (auto const* access : {&c.public_bases, &c.protected_bases,
+                               &c.private_bases}) {
+      for (auto& base : *access) {
+        bases.insert(simple_name(helper::to_string(base)));
+      }
+    }
+  }
+
+  /**
+   * Where the current class or enum is declared
+   *
+   * Nested is inside classes that are inside a namespace, None is anywhere
+   * reflection can't be generated e.g. inside a function or a class template
+   */
+  enum class Placement { Namespace, Nested, None };
+
+  Placement current_placement() {
     auto& std_parser = parent.template get_parser<Parent::std_parser_id>();
     auto const& code_fragments = std_parser.get_all_code_fragments();
-    if (code_fragments.size() <= 1) {
-      return false;
+    for (auto i = code_fragments.size() - 1; i-- > 0;) {
+      auto& fragment = code_fragments[i];
+      if (std::holds_alternative<Namespace>(fragment)) {
+        return i == code_fragments.size() - 2 ? Placement::Namespace
+                                              : Placement::Nested;
+      }
+
+      auto enclosing = std::get_if<Class>(&fragment);
+      if (!enclosing || enclosing->template_parameters) {
+        return Placement::None;
+      }
     }
 
-    auto& before_current = code_fragments[code_fragments.size() - 2];
-    return std::holds_alternative<Namespace>(before_current);
+    return Placement::None;
   }
 
 
@@ -373,32 +1046,191 @@ class StaticReflexParser {
   Parent& parent;
 
   bool in_reflexpr = false;
+  char const* reflexpr_begin = nullptr;
+
+  // when set only these types and the ones nested in them are reflected
+  std::optional<std::unordered_set<std::string>> reflected_types;
+
+  // when set the reflection of the types in headers is written to a file
+  // per header in this dir, to be included through one shared header
+  fs::path shared_reflection_dir;
+  std::string shared_reflection;
+  // the namespaces of the type whose reflection goes to the shared header
+  std::vector<std::string> shared_namespaces;
+
+  // when collecting, the types named in reflexpr are written to this file
+  fs::path reflected_types_out;
+  std::set<std::string> named_types;
+  std::map<std::string, std::set<std::string>> bases_of;
+
+ public:
+  /**
+   * How the generated metadata is represented
+   *
+   * Flat uses constexpr arrays and flat type and value packs that are indexed
+   * in constant time, Tuple the original std::tuple based representation
+   */
+  enum class Representation { Flat, Tuple };
+
+ private:
+  Representation representation;
+
+  // opt-in generation of Reflect<T>::serialize and Reflect<T>::deserialize
+  bool with_serializers;
+
+  // opt-in generation of the named accessors of reflect::soa_vector
+  bool with_soa;
+
+  // opt-in generation of Reflect<T>::equal, compare and hash along with
+  // the comparison operators and std::hash
+  bool with_comparisons;
 
  public:
   // TODO: when supported in std=c++2a change to fixed length string
   constexpr static int id = 5;
 
-  StaticReflexParser(Parent& p) : parent{p} {}
+  StaticReflexParser(
+      Parent& p, Representation representation = Representation::Flat,
+      bool with_serializers = false, bool with_soa = false,
+      bool with_comparisons = false,
+      std::optional<std::unordered_set<std::string>> reflected_types = {},
+      fs::path shared_reflection_dir = {})
+      : parent{p},
+        reflected_types{std::move(reflected_types)},
+        shared_reflection_dir{std::move(shared_reflection_dir)},
+        representation{representation},
+        with_serializers{with_serializers},
+        with_soa{with_soa},
+        with_comparisons{with_comparisons} {}
+
+  /**
+   * Only collect the types named in reflexpr and their bases while
+   * preprocessing, and write them to the file
+   */
+  StaticReflexParser(Parent& p, fs::path reflected_types_out)
+      : parent{p},
+        reflected_types_out{std::move(reflected_types_out)},
+        representation{Representation::Flat},
+        with_serializers{false},
+        with_soa{false},
+        with_comparisons{false} {}
 
   /**
    * A string to prepend to each file's start
    */
-  std::string get_prepend() { return "#include<reflect.hpp>\n"; }
+  std::string get_prepend() {
+    std::string prepend = "#include<reflect.hpp>\n";
+    if (with_serializers) {
+      prepend += "#include<serialize.hpp>\n";
+    }
+    if (with_comparisons) {
+      prepend += "#include<compare.hpp>\n";
+    }
+    return prepend;
+  }
 
   template <class Source>
   using Out = std::optional<
       Result<decltype(std::declval<Source>().begin()), std::string>>;
 
+  /**
+   * Collect the types named in reflexpr and the bases of every class
+   */
+  template <class Source>
+  Out<Source> preprocess(Source& source) {
+    if (reflected_types_out.empty()) {
+      return std::nullopt;
+    }
+
+    auto& std_parser = parent.template get_parser<Parent::std_parser_id>();
+    auto& current = std_parser.get_current_code_fragment();
+    if (auto c = std::get_if<Class>(&current)) {
+      // NOTE: the std parser still closes the class
+      if (parse_end_of_scope(source)) {
+        collect_bases(*c);
+      }
+    } else if (std::holds_alternative<Expression>(current)) {
+      auto begin_of_reflexpr = parse_reflexpr(source);
+      return begin_of_reflexpr ? process_reflexpr(*begin_of_reflexpr)
+                               : std::nullopt;
+    } else if (in_reflexpr && std::holds_alternative<RoundExpression>(current)) {
+      char const* end_of_type = &*source.begin();
+      auto end_of_reflexpr = parse_end_reflexpr(source);
+      if (end_of_reflexpr) {
+        named_types.insert(simple_name(
+            {reflexpr_begin, static_cast<std::size_t>(end_of_type -
+                                                      reflexpr_begin)}));
+        return close_reflexpr(*end_of_reflexpr);
+      }
+    }
+
+    return std::nullopt;
+  }
+
+  /**
+   * Write the named types and all of their bases
+   */
+  void finish_preprocess() {
+    if (reflected_types_out.empty()) {
+      return;
+    }
+
+    auto types = named_types;
+    std::vector<std::string> to_visit(types.begin(), types.end());
+    while (!to_visit.empty()) {
+      auto name = std::move(to_visit.back());
+      to_visit.pop_back();
+      for (auto& base : bases_of[name]) {
+        if (types.insert(base).second) {
+          to_visit.push_back(base);
+        }
+      }
+    }
+
+    std::ostringstream out;
+    for (auto& type : types) {
+      out << type << '\n';
+    }
+    source::write_if_changed(reflected_types_out, out.str());
+  }
+
+  /**
+   * Write the shared reflection of the processed header
+   */
+  void finish_process() {
+    if (shares_reflection()) {
+      std::string out = "#pragma once\n";
+      out += get_prepend();
+      out += shared_reflection;
+      source::write_if_changed(
+          shared_reflection_path(shared_reflection_dir,
+                                 parent.get_current_file_name()),
+          out);
+    }
+    shared_reflection.clear();
+  }
+
   template <class Source>
   Out<Source> parse(Source& source) {
     auto& std_parser = parent.template get_parser<Parent::std_parser_id>();
     if (std_parser.template is_current_code_fragment<Class, Enumeration>()) {
-      // TODO: generate reflection for nested structs inside a struct
-      if (not is_current_code_fragment_inside_namespace()) {
+      auto placement = current_placement();
+      if (placement == Placement::None) {
         return std::nullopt;
       }
+
+      // NOTE: the reflection of nested types is generated by the outermost
+      // class, nested classes only add the friend declarations
+      bool is_nested = placement == Placement::Nested;
+      if (is_nested) {
+        auto nested = std::get_if<Class>(&std_parser.get_current_code_fragment());
+        if (!nested || !is_reflectable_nested(*nested)) {
+          return std::nullopt;
+        }
+      }
       auto end_of_scope = parse_end_of_scope(source);
-      return end_of_scope ? get_reflection(*end_of_scope) : std::nullopt;
+      return end_of_scope ? get_reflection(*end_of_scope, is_nested)
+                          : std::nullopt;
     } else if (std_parser.template is_current_code_fragment<Expression>()) {
       auto begin_of_reflexpr = parse_reflexpr(source);
       return begin_of_reflexpr ? process_reflexpr(*begin_of_reflexpr)
@@ -0,0 +1,179 @@
+#ifndef ALLOC_STATS_H
+#define ALLOC_STATS_H
+
+/**
+ * Opt-in counting of the allocations and the allocated bytes per phase,
+ * enabled by defining ZERO_PREPROCESSOR_ALLOC_STATS in the executable that
+ * replaces the global operator new to call alloc_stats::count
+ *
+ * A phase is entered with ALLOC_STATS_SCOPE(name) and lasts until the end
+ * of the enclosing block, phases with the same name are merged and the
+ * ranked report is printed to stderr at exit
+ */
+#ifdef ZERO_PREPROCESSOR_ALLOC_STATS
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+#include <boost/core/demangle.hpp>
+
+namespace alloc_stats {
+struct Phase {
+  std::string name;
+  std::atomic<std::size_t> calls{0};
+  // allocated while the phase was the innermost one
+  std::atomic<std::size_t> self_allocations{0};
+  std::atomic<std::size_t> self_bytes{0};
+  // allocated while the phase was active, with its nested phases
+  std::atomic<std::size_t> total_allocations{0};
+  std::atomic<std::size_t> total_bytes{0};
+
+  explicit Phase(std::string name) : name{std::move(name)} {}
+};
+
+// NOTE: constant initialized so they can be used by operator new at any
+// point of the static initialization
+inline std::atomic<std::size_t> unattributed_allocations{0};
+inline std::atomic<std::size_t> unattributed_bytes{0};
+
+inline thread_local Phase* current_phase = nullptr;
+inline thread_local std::size_t thread_allocations = 0;
+inline thread_local std::size_t thread_bytes = 0;
+
+inline void report(std::ostream& out, std::deque<Phase> const& phases) {
+  std::vector<Phase const*> ranked;
+  std::size_t allocations = unattributed_allocations;
+  std::size_t bytes = unattributed_bytes;
+  for (auto& phase : phases) {
+    ranked.push_back(&phase);
+    allocations += phase.self_allocations;
+    bytes += phase.self_bytes;
+  }
+  std::sort(ranked.begin(), ranked.end(), [](auto a, auto b) {
+    return a->self_bytes > b->self_bytes;
+  });
+
+  out << "allocations per phase, ranked by the bytes allocated in the phase "
+         "itself:\n";
+  out << std::setw(12) << "self allocs" << std::setw(14) << "self bytes"
+      << std::setw(13) << "total allocs" << std::setw(14) << "total bytes"
+      << std::setw(10) << "calls"
+      << "  phase\n";
+  for (auto phase : ranked) {
+    out << std::setw(12) << phase->self_allocations << std::setw(14)
+        << phase->self_bytes << std::setw(13) << phase->total_allocations
+        << std::setw(14) << phase->total_bytes << std::setw(10)
+        << phase->calls << "  " << phase->name << '\n';
+  }
+  out << std::setw(12) << unattributed_allocations << std::setw(14)
+      << unattributed_bytes << std::setw(37) << ""
+      << "  (outside of any phase)\n";
+  out << std::setw(12) << allocations << std::setw(14) << bytes
+      << std::setw(37) << ""
+      << "  (all)\n";
+}
+
+class Registry {
+  std::mutex mutex;
+  // NOTE: a deque so the phases are not moved when new ones are added
+  std::deque<Phase> phases;
+
+ public:
+  ~Registry() { report(std::cerr, phases); }
+
+  Phase& get(std::string name) {
+    std::lock_guard lock{mutex};
+    auto it = std::find_if(phases.begin(), phases.end(),
+                           [&name](auto& phase) { return phase.name == name; });
+    if (it != phases.end()) {
+      return *it;
+    }
+
+    return phases.emplace_back(std::move(name));
+  }
+};
+
+inline Registry& registry() {
+  static Registry registry;
+  return registry;
+}
+
+inline Phase& get_phase(std::string name) {
+  return registry().get(std::move(name));
+}
+
+/**
+ * The name of the type without its template arguments
+ */
+template <class T>
+std::string type_name() {
+  auto name = boost::core::demangle(typeid(T).name());
+  return name.substr(0, name.find('<'));
+}
+
+/**
+ * Count an allocation, called by the replaced operator new
+ */
+inline void count(std::size_t size) {
+  ++thread_allocations;
+  thread_bytes += size;
+  if (auto phase = current_phase) {
+    phase->self_allocations.fetch_add(1, std::memory_order_relaxed);
+    phase->self_bytes.fetch_add(size, std::memory_order_relaxed);
+  } else {
+    unattributed_allocations.fetch_add(1, std::memory_order_relaxed);
+    unattributed_bytes.fetch_add(size, std::memory_order_relaxed);
+  }
+}
+
+/**
+ * Makes the phase the innermost one of this thread while it lives
+ */
+class Scope {
+  Phase& phase;
+  Phase* parent;
+  std::size_t allocations;
+  std::size_t bytes;
+
+ public:
+  explicit Scope(Phase& phase)
+      : phase{phase},
+        parent{current_phase},
+        allocations{thread_allocations},
+        bytes{thread_bytes} {
+    current_phase = &phase;
+    phase.calls.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  Scope(Scope const&) = delete;
+  Scope& operator=(Scope const&) = delete;
+
+  ~Scope() {
+    phase.total_allocations.fetch_add(thread_allocations - allocations,
+                                      std::memory_order_relaxed);
+    phase.total_bytes.fetch_add(thread_bytes - bytes,
+                                std::memory_order_relaxed);
+    current_phase = parent;
+  }
+};
+}  // namespace alloc_stats
+
+#define ALLOC_STATS_SCOPE(name)                                      \
+  static auto& alloc_stats_phase = ::alloc_stats::get_phase(name); \
+  ::alloc_stats::Scope alloc_stats_scope { alloc_stats_phase }
+
+#else
+
+#define ALLOC_STATS_SCOPE(name)
+
+#endif  // ZERO_PREPROCESSOR_ALLOC_STATS
+
+#endif  // ALLOC_STATS_H
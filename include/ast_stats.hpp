@@ -0,0 +1,370 @@
+#ifndef AST_STATS_H
+#define AST_STATS_H
+
+#include <cstddef>
+#include <iomanip>
+#include <list>
+#include <map>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+#include <heap_obj.hpp>
+#include <std_ast.hpp>
+
+/**
+ * Memory footprint of the AST built by the StdParser, used by --stats
+ *
+ * The bytes of the nodes are the ones inside their parents, the heap bytes
+ * of the strings and the vectors are counted from their capacity and the
+ * ones of the node based containers are estimated from their size
+ */
+namespace std_parser::ast_stats {
+namespace ast = rules::ast;
+
+struct NodeStats {
+  std::size_t count = 0;
+  std::size_t size = 0;
+};
+
+struct Stats {
+  std::map<std::string_view, NodeStats> nodes;
+  std::size_t string_bytes = 0;
+  std::size_t vector_bytes = 0;
+  // bytes of the variants not used by their current alternative
+  std::size_t variant_padding = 0;
+  // maps, lists and heap objects
+  std::size_t other_bytes = 0;
+
+  std::size_t node_count() const {
+    std::size_t count = 0;
+    for (auto& [kind, node] : nodes) {
+      count += node.count;
+    }
+    return count;
+  }
+};
+
+class Walker {
+  // NOTE: a guess of the bookkeeping of a node of a map or a list
+  static constexpr std::size_t node_overhead = 4 * sizeof(void*);
+
+  template <class T>
+  void node(std::string_view kind) {
+    auto& n = stats.nodes[kind];
+    ++n.count;
+    n.size = sizeof(T);
+  }
+
+ public:
+  Stats stats;
+
+  void walk(bool) {}
+  void walk(char) {}
+  void walk(double) {}
+  void walk(std::int64_t) {}
+  void walk(ast::Operator) {}
+  void walk(ast::TypeQualifier) {}
+
+  void walk(std::string const& s) {
+    // NOTE: short strings are kept inside the string itself
+    if (s.capacity() > std::string{}.capacity()) {
+      stats.string_bytes += s.capacity() + 1;
+    }
+  }
+
+  template <class T>
+  void walk(std::vector<T> const& v) {
+    stats.vector_bytes += v.capacity() * sizeof(T);
+    for (auto& e : v) {
+      walk(e);
+    }
+  }
+
+  template <class T>
+  void walk(std::list<T> const& l) {
+    stats.other_bytes += l.size() * (sizeof(T) + node_overhead);
+    for (auto& e : l) {
+      walk(e);
+    }
+  }
+
+  template <class K, class V>
+  void walk(std::map<K, V> const& m) {
+    stats.other_bytes +=
+        m.size() * (sizeof(typename std::map<K, V>::value_type) + node_overhead);
+    for (auto& [key, value] : m) {
+      walk(key);
+      walk(value);
+    }
+  }
+
+  template <class K, class V>
+  void walk(std::unordered_map<K, V> const& m) {
+    stats.other_bytes +=
+        m.size() * (sizeof(typename std::unordered_map<K, V>::value_type) +
+                    node_overhead) +
+        m.bucket_count() * sizeof(void*);
+    for (auto& [key, value] : m) {
+      walk(key);
+      walk(value);
+    }
+  }
+
+  template <class T>
+  void walk(std::optional<T> const& o) {
+    if (o) {
+      walk(*o);
+    }
+  }
+
+  template <class T>
+  void walk(HeapObj<T> const& h) {
+    if (h) {
+      stats.other_bytes += sizeof(T);
+      walk(*h);
+    }
+  }
+
+  template <class... Ts>
+  void walk(std::variant<Ts...> const& v) {
+    std::visit(
+        [this](auto& alternative) {
+          stats.variant_padding +=
+              sizeof(std::variant<Ts...>) - sizeof(alternative);
+          walk(alternative);
+        },
+        v);
+  }
+
+  void walk(ast::Namespace const& n) {
+    node<ast::Namespace>("Namespace");
+    walk(n.get_name());
+    walk(n.get_all_code_fragments());
+  }
+
+  void walk(ast::Class const& c) {
+    node<ast::Class>("Class");
+    walk(c.name);
+    walk(c.template_parameters);
+    walk(c.specialization);
+    walk(c.public_bases);
+    walk(c.protected_bases);
+    walk(c.private_bases);
+    walk(c.classes);
+    walk(c.enums);
+    walk(c.public_methods);
+    walk(c.protected_methods);
+    walk(c.private_methods);
+    walk(c.unspecified_methods);
+    walk(c.public_members);
+    walk(c.protected_members);
+    walk(c.private_members);
+    walk(c.unspecified_members);
+  }
+
+  void walk(ast::Enumeration const& e) {
+    node<ast::Enumeration>("Enumeration");
+    walk(e.name);
+    walk(e.as);
+    walk(e.enumerators);
+  }
+
+  void walk(ast::Function const& f) {
+    node<ast::Function>("Function");
+    walk(f.template_parameters);
+    walk(f.return_type);
+    walk(f.name);
+    walk(f.parameters.parameters);
+    walk(f.statements);
+    walk(f.body);
+  }
+
+  void walk(ast::FunctionDeclaration const& f) {
+    node<ast::FunctionDeclaration>("FunctionDeclaration");
+    walk(f.template_parameters);
+    walk(f.return_type);
+    walk(f.name);
+    walk(f.parameters.parameters);
+  }
+
+  void walk(ast::UserDeductionGuide const& u) {
+    node<ast::UserDeductionGuide>("UserDeductionGuide");
+    walk(u.template_parameters);
+    walk(u.name);
+    walk(u.parameters.parameters);
+    walk(u.return_type);
+  }
+
+  void walk(ast::Params const& p) {
+    node<ast::Params>("Params");
+    walk(p.parameters);
+  }
+
+  void walk(ast::var const& v) {
+    node<ast::var>("var");
+    walk(v.type);
+    walk(v.name);
+    walk(v.init);
+  }
+
+  void walk(ast::Vars const& v) {
+    node<ast::Vars>("Vars");
+    walk(v.variables);
+  }
+
+  void walk(ast::Scope const& s) {
+    node<ast::Scope>("Scope");
+    walk(s.get_all_classes());
+    walk(s.get_all_variables());
+    walk(s.statements);
+  }
+
+  void walk(ast::Statement const& s) {
+    node<ast::Statement>("Statement");
+    walk(s.expression);
+  }
+
+  void walk(ast::ReturnStatement const& s) {
+    node<ast::ReturnStatement>("ReturnStatement");
+    walk(s.expression);
+  }
+
+  void walk(ast::IfStatement const& s) {
+    node<ast::IfStatement>("IfStatement");
+    walk(s.if_init);
+    walk(s.if_expression);
+    walk(s.body);
+    walk(s.else_if_statements);
+    walk(s.else_body);
+  }
+
+  void walk(ast::Expression const& e) {
+    node<ast::Expression>("Expression");
+    walk(e.expressions);
+    walk(e.operators);
+  }
+
+  void walk(ast::RoundExpression const& e) {
+    node<ast::RoundExpression>("RoundExpression");
+    walk(e.functor);
+    walk(e.expressions);
+    walk(e.operators);
+  }
+
+  void walk(ast::CurlyExpression const& e) {
+    node<ast::CurlyExpression>("CurlyExpression");
+    walk(e.type);
+    walk(e.expressions);
+    walk(e.operators);
+  }
+
+  void walk(ast::Lambda const& l) {
+    node<ast::Lambda>("Lambda");
+    walk(l.statements);
+  }
+
+  void walk(ast::VariableExpression const& e) {
+    node<ast::VariableExpression>("VariableExpression");
+    walk(e.expression);
+  }
+
+  void walk(ast::LiteralExpression const& e) {
+    node<ast::LiteralExpression>("LiteralExpression");
+    walk(e.lit.lit);
+    walk(e.type);
+  }
+
+  void walk(ast::TemplateParameter const& t) {
+    node<ast::TemplateParameter>("TemplateParameter");
+    walk(t.type);
+    walk(t.name);
+  }
+
+  void walk(ast::Type const& t) {
+    node<ast::Type>("Type");
+    walk(t.left_qualifiers);
+    walk(t.type);
+    walk(t.right_qualifiers);
+  }
+
+  void walk(ast::UnqulifiedType const& t) { walk(t.type); }
+
+  void walk(ast::unqulified_type const& t) {
+    node<ast::unqulified_type>("unqulified_type");
+    walk(t.name);
+    walk(t.template_types);
+  }
+
+  void walk(ast::TemplateTypes const& t) { walk(t.template_types); }
+};
+
+/**
+ * Walk the code fragments of the StdParser, the first one is the top
+ * namespace with all of the closed fragments
+ */
+template <class CodeFragments>
+Stats collect(CodeFragments const& code_fragments) {
+  Walker walker;
+  walker.walk(code_fragments);
+  return walker.stats;
+}
+
+/**
+ * Peak resident set size of this process or of its waited for children
+ * in KB, empty where it is not supported
+ */
+inline std::optional<long> peak_rss_kb(bool children = false) {
+#if defined(__unix__) || defined(__APPLE__)
+  rusage usage{};
+  if (getrusage(children ? RUSAGE_CHILDREN : RUSAGE_SELF, &usage) != 0) {
+    return std::nullopt;
+  }
+#ifdef __APPLE__
+  // NOTE: in bytes on macOS
+  return usage.ru_maxrss / 1024;
+#else
+  return usage.ru_maxrss;
+#endif
+#else
+  return std::nullopt;
+#endif
+}
+
+inline void report(std::ostream& out, std::string_view stage,
+                   Stats const& stats) {
+  out << stage << " AST: " << stats.node_count() << " nodes\n";
+  out << std::setw(24) << "kind" << std::setw(10) << "count" << std::setw(8)
+      << "size" << std::setw(14) << "bytes\n";
+  for (auto& [kind, node] : stats.nodes) {
+    out << std::setw(24) << kind << std::setw(10) << node.count
+        << std::setw(8) << node.size << std::setw(13) << node.count * node.size
+        << '\n';
+  }
+  out << stage << " AST strings: " << stats.string_bytes << " bytes\n";
+  out << stage << " AST vectors: " << stats.vector_bytes << " bytes\n";
+  out << stage << " AST maps, lists and heap objects: ~" << stats.other_bytes
+      << " bytes\n";
+  out << stage << " AST wasted variant padding: " << stats.variant_padding
+      << " bytes\n";
+}
+
+inline void report_peak_rss(std::ostream& out, std::string_view stage) {
+  if (auto rss = peak_rss_kb()) {
+    out << stage << " peak RSS: " << *rss << " KB\n";
+  }
+  if (auto rss = peak_rss_kb(true); rss && *rss > 0) {
+    out << stage << " peak RSS of the child processes: " << *rss << " KB\n";
+  }
+}
+}  // namespace std_parser::ast_stats
+
+#endif  // AST_STATS_H
@@ -0,0 +1,154 @@
+#ifndef COMPILE_COMMANDS_H
+#define COMPILE_COMMANDS_H
+
+#include <filesystem>
+#include <map>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+namespace fs = std::filesystem;
+
+/**
+ * Reading of the sources and their include directories from a
+ * compile_commands.json, for the projects that don't use preprocess()
+ */
+namespace compile_commands {
+struct Entry {
+  fs::path directory;
+  fs::path file;
+  std::vector<std::string> include_dirs;
+};
+
+/**
+ * Split a command line into its arguments the way a POSIX shell does for
+ * the quotes and the backslashes
+ */
+inline std::vector<std::string> split_command(std::string_view command) {
+  std::vector<std::string> args;
+  std::string arg;
+  bool in_arg = false;
+  char quote = '\0';
+  for (std::size_t i = 0; i < command.size(); ++i) {
+    char c = command[i];
+    if (quote == '\'') {
+      if (c == quote) {
+        quote = '\0';
+      } else {
+        arg += c;
+      }
+    } else if (c == '\\' && i + 1 < command.size() &&
+               (quote == '\0' || command[i + 1] == '"' ||
+                command[i + 1] == '\\')) {
+      arg += command[++i];
+      in_arg = true;
+    } else if (quote == '"') {
+      if (c == quote) {
+        quote = '\0';
+      } else {
+        arg += c;
+      }
+    } else if (c == '"' || c == '\'') {
+      quote = c;
+      in_arg = true;
+    } else if (c == ' ' || c == '\t' || c == '\n') {
+      if (in_arg) {
+        args.push_back(std::move(arg));
+        arg.clear();
+        in_arg = false;
+      }
+    } else {
+      arg += c;
+      in_arg = true;
+    }
+  }
+  if (in_arg) {
+    args.push_back(std::move(arg));
+  }
+  return args;
+}
+
+/**
+ * The include directories of the compiler arguments in their order,
+ * relative ones are resolved from the directory of the command
+ */
+inline std::vector<std::string> get_include_dirs(
+    std::vector<std::string> const& args, fs::path const& directory) {
+  std::vector<std::string> include_dirs;
+  auto add = [&](std::string_view dir) {
+    include_dirs.push_back((directory / dir).lexically_normal().string());
+  };
+
+  for (std::size_t i = 0; i < args.size(); ++i) {
+    std::string_view arg = args[i];
+    for (std::string_view flag : {"-isystem", "-iquote", "-I", "/I"}) {
+      if (arg.substr(0, flag.size()) != flag) {
+        continue;
+      }
+      if (arg.size() > flag.size()) {
+        add(arg.substr(flag.size()));
+      } else if (i + 1 < args.size()) {
+        add(args[++i]);
+      }
+      break;
+    }
+  }
+  return include_dirs;
+}
+
+/**
+ * Read the entries of the compile_commands.json, with the paths made
+ * absolute
+ *
+ * Throws boost::property_tree::json_parser_error if it can't be read
+ */
+inline std::vector<Entry> read(fs::path const& path) {
+  namespace pt = boost::property_tree;
+  pt::ptree root;
+  pt::read_json(path.string(), root);
+
+  std::vector<Entry> entries;
+  for (auto& [key, node] : root) {
+    Entry entry;
+    entry.directory = fs::absolute(node.get<std::string>("directory"));
+    entry.file = (entry.directory / node.get<std::string>("file"))
+                     .lexically_normal();
+
+    std::vector<std::string> args;
+    if (auto arguments = node.get_child_optional("arguments")) {
+      for (auto& [index, arg] : *arguments) {
+        args.push_back(arg.get_value<std::string>());
+      }
+    } else {
+      args = split_command(node.get<std::string>("command", ""));
+    }
+    entry.include_dirs = get_include_dirs(args, entry.directory);
+    entries.push_back(std::move(entry));
+  }
+  return entries;
+}
+
+/**
+ * The entries grouped by their include directories, a source listed more
+ * than once, e.g. for several configurations, is only kept once
+ */
+inline std::map<std::vector<std::string>, std::vector<Entry>>
+group_by_include_dirs(std::vector<Entry> entries) {
+  std::map<std::vector<std::string>, std::vector<Entry>> groups;
+  std::set<fs::path> seen;
+  for (auto& entry : entries) {
+    if (!seen.insert(entry.file).second) {
+      continue;
+    }
+    auto include_dirs = entry.include_dirs;
+    groups[std::move(include_dirs)].push_back(std::move(entry));
+  }
+  return groups;
+}
+}  // namespace compile_commands
+
+#endif  // COMPILE_COMMANDS_H
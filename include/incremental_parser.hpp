@@ -0,0 +1,728 @@
+#ifndef INCREMENTAL_PARSER_H
+#define INCREMENTAL_PARSER_H
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <iterator>
+#include <list>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <heap_obj.hpp>
+#include <std_ast.hpp>
+#include <std_parser.hpp>
+
+/**
+ * Reparsing of a changed source where only the top level declarations that
+ * changed since its previous version go through the grammar again
+ *
+ * The source is split into top level chunks by balanced brace
+ * resynchronization at namespace scope, each chunk is a run of complete
+ * declarations, the beginning of a namespace or its closing brace
+ */
+namespace std_parser::incremental {
+namespace ast = rules::ast;
+
+enum class ChunkKind { Declarations, NamespaceBegin, NamespaceEnd };
+
+/**
+ * A top level chunk of the source with its byte range and content hash
+ */
+struct Chunk {
+  std::size_t begin;
+  std::size_t end;
+  std::uint64_t hash;
+  ChunkKind kind;
+};
+
+/**
+ * FNV-1a of the content
+ */
+inline std::uint64_t hash(std::string_view content) {
+  std::uint64_t h = 14695981039346656037ull;
+  for (unsigned char c : content) {
+    h = (h ^ c) * 1099511628211ull;
+  }
+  return h;
+}
+
+class Splitter {
+  std::string_view s;
+  std::size_t i = 0;
+
+  static bool is_identifier(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+  }
+
+  bool starts_with(std::string_view prefix) const {
+    return s.substr(i, prefix.size()) == prefix;
+  }
+
+  bool is_line_start(std::size_t at) const {
+    while (at > 0 && (s[at - 1] == ' ' || s[at - 1] == '\t')) {
+      --at;
+    }
+    return at == 0 || s[at - 1] == '\n';
+  }
+
+  /**
+   * Skip a comment or a preprocessor line, false if there is none at i
+   */
+  bool skip_trivia() {
+    if (starts_with("//")) {
+      i = std::min(s.find('\n', i), s.size());
+    } else if (starts_with("/*")) {
+      auto end = s.find("*/", i + 2);
+      if (end == std::string_view::npos) {
+        throw std::runtime_error("unterminated comment");
+      }
+      i = end + 2;
+    } else if (s[i] == '#' && is_line_start(i)) {
+      // NOTE: the line continues after a backslash
+      while (i < s.size() && !(s[i] == '\n' && s[i - 1] != '\\')) {
+        ++i;
+      }
+      i = std::min(i + 1, s.size());
+    } else {
+      return false;
+    }
+    return true;
+  }
+
+  /**
+   * The first character after the whitespace and the comments from i
+   */
+  char peek() {
+    auto at = i;
+    while (i < s.size()) {
+      if (std::isspace(static_cast<unsigned char>(s[i]))) {
+        ++i;
+      } else if (s[i] == '#' || !skip_trivia()) {
+        break;
+      }
+    }
+    char c = i < s.size() ? s[i] : '\0';
+    i = at;
+    return c;
+  }
+
+  void skip_quoted(char quote) {
+    for (++i; i < s.size() && s[i] != quote; ++i) {
+      if (s[i] == '\\') {
+        ++i;
+      }
+    }
+    if (i >= s.size()) {
+      throw std::runtime_error("unterminated literal");
+    }
+    ++i;
+  }
+
+  /**
+   * Skip the template parameters after template so their class and
+   * typename are not taken for a class declaration
+   */
+  void skip_template_parameters() {
+    while (i < s.size() && std::isspace(static_cast<unsigned char>(s[i]))) {
+      ++i;
+    }
+    int angles = 0;
+    int parens = 0;
+    do {
+      if (i >= s.size()) {
+        throw std::runtime_error("unterminated template parameters");
+      }
+      char c = s[i];
+      if (c == '"' || c == '\'') {
+        skip_quoted(c);
+        continue;
+      }
+      if (c == '(') {
+        ++parens;
+      } else if (c == ')') {
+        --parens;
+      } else if (c == '<' && parens == 0) {
+        ++angles;
+      } else if (c == '>' && parens == 0) {
+        --angles;
+      }
+      ++i;
+    } while (angles > 0);
+  }
+
+  void skip_raw_string() {
+    auto paren = s.find('(', i);
+    if (paren == std::string_view::npos) {
+      throw std::runtime_error("unterminated raw string");
+    }
+    std::string close = ")";
+    close.append(s.substr(i + 1, paren - i - 1));
+    close += '"';
+    auto end = s.find(close, paren);
+    if (end == std::string_view::npos) {
+      throw std::runtime_error("unterminated raw string");
+    }
+    i = end + close.size();
+  }
+
+ public:
+  explicit Splitter(std::string_view s) : s{s} {}
+
+  /**
+   * The chunks of the source, throws if the braces are not balanced
+   */
+  std::vector<Chunk> split() {
+    std::vector<Chunk> chunks;
+    std::size_t begin = 0;
+    bool in_declaration = false;
+    // NOTE: the braces of a class, an enum or an initializer are followed
+    // by declarators, so the declaration only ends at its semicolon
+    bool until_semicolon = false;
+    bool is_namespace = false;
+    int depth = 0;
+    int namespaces = 0;
+
+    auto end_chunk = [&](ChunkKind kind) {
+      chunks.push_back({begin, i, hash(s.substr(begin, i - begin)), kind});
+      begin = i;
+      in_declaration = until_semicolon = is_namespace = false;
+    };
+
+    while (i < s.size()) {
+      char c = s[i];
+      if (std::isspace(static_cast<unsigned char>(c))) {
+        ++i;
+        continue;
+      }
+
+      bool directive = c == '#' && is_line_start(i);
+      if (skip_trivia()) {
+        // includes and the other directives at namespace scope are chunks
+        if (directive && !in_declaration && depth == 0) {
+          end_chunk(ChunkKind::Declarations);
+        }
+        continue;
+      }
+
+      // the closing brace of a namespace
+      if (c == '}' && depth == 0) {
+        if (namespaces == 0 || in_declaration) {
+          throw std::runtime_error("extraneous closing brace ('}')");
+        }
+        ++i;
+        --namespaces;
+        end_chunk(ChunkKind::NamespaceEnd);
+        continue;
+      }
+
+      in_declaration = true;
+      if (c == '"' || c == '\'') {
+        skip_quoted(c);
+      } else if (std::isdigit(static_cast<unsigned char>(c))) {
+        // NOTE: with the ' digit separators
+        while (i < s.size() && (is_identifier(s[i]) || s[i] == '.' ||
+                                s[i] == '\'')) {
+          ++i;
+        }
+      } else if (is_identifier(c)) {
+        auto word_begin = i;
+        while (i < s.size() && is_identifier(s[i])) {
+          ++i;
+        }
+        auto word = s.substr(word_begin, i - word_begin);
+        if (i < s.size() && s[i] == '"' && !word.empty() &&
+            word.back() == 'R' &&
+            (word == "R" || word == "LR" || word == "uR" || word == "UR" ||
+             word == "u8R")) {
+          skip_raw_string();
+        } else if (depth == 0 && word == "template" && peek() == '<') {
+          skip_template_parameters();
+        } else if (depth == 0 && (word == "class" || word == "struct" ||
+                                  word == "union" || word == "enum")) {
+          until_semicolon = true;
+        } else if (depth == 0 && word == "namespace") {
+          is_namespace = true;
+        }
+      } else if (c == '(' || c == '[') {
+        ++depth;
+        ++i;
+      } else if (c == ')' || c == ']') {
+        if (--depth < 0) {
+          throw std::runtime_error("unbalanced brackets");
+        }
+        ++i;
+      } else if (c == '{') {
+        ++i;
+        if (depth == 0 && is_namespace && !until_semicolon) {
+          ++namespaces;
+          end_chunk(ChunkKind::NamespaceBegin);
+        } else {
+          ++depth;
+        }
+      } else if (c == '}') {
+        ++i;
+        // a function body ends the declaration unless declarators follow
+        char next = peek();
+        if (--depth == 0 && !until_semicolon && next != ';' && next != ',') {
+          end_chunk(ChunkKind::Declarations);
+        }
+      } else if (c == ';') {
+        ++i;
+        if (depth == 0) {
+          end_chunk(ChunkKind::Declarations);
+        }
+      } else {
+        if (c == '=' && depth == 0) {
+          until_semicolon = true;
+        }
+        ++i;
+      }
+    }
+
+    if (in_declaration || depth != 0 || namespaces != 0) {
+      throw std::runtime_error("unbalanced braces at the end of the source");
+    }
+    if (begin < s.size()) {
+      end_chunk(ChunkKind::Declarations);
+    }
+    return chunks;
+  }
+};
+
+/**
+ * Split the source into its top level chunks, empty if its braces are not
+ * balanced so it can only be parsed as a whole
+ */
+inline std::optional<std::vector<Chunk>> split(std::string_view source) {
+  try {
+    return Splitter{source}.split();
+  } catch (std::runtime_error const&) {
+    return std::nullopt;
+  }
+}
+
+/**
+ * Check if the chunk has a class, struct, union or enum keyword, matched as
+ * a whole word so e.g. a classify function is not taken for a type
+ */
+inline bool has_local_types(std::string_view chunk) {
+  auto is_identifier = [](char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+  };
+  for (std::string_view word : {"class", "struct", "union", "enum"}) {
+    for (auto at = chunk.find(word); at != std::string_view::npos;
+         at = chunk.find(word, at + 1)) {
+      auto end = at + word.size();
+      if ((at == 0 || !is_identifier(chunk[at - 1])) &&
+          (end == chunk.size() || !is_identifier(chunk[end]))) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+/**
+ * Moves the rows of the locations of a reused declaration after the lines
+ * before it changed
+ *
+ * NOTE: the local classes and variables of a scope and the content of a
+ * namespace can't be reached, complete is false if there are any
+ */
+class Relocator {
+  int rows;
+
+  template <class T>
+  void move_loc(T& node) {
+    node.loc.row = static_cast<std::uint16_t>(node.loc.row + rows);
+  }
+
+ public:
+  bool complete = true;
+
+  explicit Relocator(int rows) : rows{rows} {}
+
+  // NOTE: the types, the literals and the variable expressions have no
+  // locations
+  template <class T>
+  void walk(T&) {}
+
+  template <class T>
+  void walk(std::vector<T>& v) {
+    for (auto& e : v) {
+      walk(e);
+    }
+  }
+
+  template <class T>
+  void walk(std::list<T>& l) {
+    for (auto& e : l) {
+      walk(e);
+    }
+  }
+
+  template <class K, class V>
+  void walk(std::map<K, V>& m) {
+    for (auto& [key, value] : m) {
+      walk(value);
+    }
+  }
+
+  template <class T>
+  void walk(std::optional<T>& o) {
+    if (o) {
+      walk(*o);
+    }
+  }
+
+  template <class T>
+  void walk(HeapObj<T>& h) {
+    if (h) {
+      walk(*h);
+    }
+  }
+
+  template <class... Ts>
+  void walk(std::variant<Ts...>& v) {
+    std::visit([this](auto& alternative) { walk(alternative); }, v);
+  }
+
+  void walk(ast::Namespace& n) {
+    move_loc(n);
+    complete = complete && n.get_all_code_fragments().empty();
+  }
+
+  void walk(ast::Class& c) {
+    move_loc(c);
+    walk(c.classes);
+    walk(c.enums);
+    walk(c.public_methods);
+    walk(c.protected_methods);
+    walk(c.private_methods);
+    walk(c.unspecified_methods);
+    walk(c.public_members);
+    walk(c.protected_members);
+    walk(c.private_members);
+    walk(c.unspecified_members);
+  }
+
+  void walk(ast::Enumeration& e) { move_loc(e); }
+
+  void walk(ast::UserDeductionGuide& u) { move_loc(u); }
+
+  void walk(ast::Function& f) {
+    move_loc(f);
+    walk(f.parameters.parameters);
+    walk(f.statements);
+  }
+
+  void walk(ast::var& v) {
+    move_loc(v);
+    walk(v.init);
+  }
+
+  void walk(ast::Vars& v) {
+    move_loc(v);
+    walk(v.variables);
+  }
+
+  void walk(ast::Scope& s) {
+    move_loc(s);
+    complete = complete && s.get_all_classes().empty() &&
+               s.get_all_variables().empty();
+    walk(s.statements);
+  }
+
+  void walk(ast::Statement& s) {
+    move_loc(s);
+    walk(s.expression);
+  }
+
+  void walk(ast::ReturnStatement& s) {
+    move_loc(s);
+    walk(s.expression);
+  }
+
+  void walk(ast::IfStatement& s) {
+    move_loc(s);
+    walk(s.if_init);
+    walk(s.if_expression);
+    walk(s.body);
+    walk(s.else_if_statements);
+    walk(s.else_body);
+  }
+
+  void walk(ast::Expression& e) {
+    move_loc(e);
+    walk(e.expressions);
+  }
+
+  void walk(ast::RoundExpression& e) {
+    move_loc(e);
+    walk(e.expressions);
+  }
+
+  void walk(ast::CurlyExpression& e) {
+    move_loc(e);
+    walk(e.expressions);
+  }
+
+  void walk(ast::Lambda& l) {
+    move_loc(l);
+    walk(l.statements);
+  }
+};
+
+inline bool reuse_enabled = false;
+
+/**
+ * Keep the previous version of every source for the next runs of a
+ * resident preprocessor, the watch mode and the server
+ */
+inline void enable_reuse() { reuse_enabled = true; }
+
+/**
+ * The StdParser of the stages, once reuse is enabled it keeps the free
+ * functions of the previous version of every source and adds the ones of the
+ * unchanged chunks without parsing them again
+ *
+ * The other parsers are offered every position the StdParser is, so a chunk
+ * is only reused when the StdParser parsed all of it the last time, with the
+ * same parsers since every Preprocessor type has its own versions
+ *
+ * NOTE: chunks with local types are always parsed, their reflection depends
+ * on more than their content
+ */
+template <class Parent>
+class ReusingStdParser : public StdParser {
+  struct ReusableChunk {
+    Chunk chunk;
+    std::uint16_t row;
+    std::uint16_t col;
+    std::vector<ast::Function> functions;
+  };
+
+  struct Version {
+    std::string content;
+    std::vector<ReusableChunk> chunks;
+  };
+
+  struct Recording {
+    std::size_t chunk;
+    std::uint16_t row;
+    std::uint16_t col;
+    std::size_t depth;
+    std::size_t fragments;
+  };
+
+  inline static std::mutex versions_mutex;
+  inline static std::unordered_map<std::string, Version> versions;
+
+  std::string path;
+  std::string_view content;
+  std::vector<Chunk> chunks;
+  Version previous;
+  std::unordered_multimap<std::uint64_t, std::size_t> previous_chunks;
+  Version current;
+  std::size_t covered_to = 0;
+  std::optional<Recording> recording;
+  std::size_t reused = 0;
+  bool active = false;
+
+  /**
+   * The Declarations chunk beginning at the position
+   */
+  std::optional<std::size_t> chunk_at(std::size_t position) const {
+    auto it = std::lower_bound(
+        chunks.begin(), chunks.end(), position,
+        [](Chunk const& chunk, std::size_t p) { return chunk.begin < p; });
+    if (it == chunks.end() || it->begin != position ||
+        it->kind != ChunkKind::Declarations) {
+      return std::nullopt;
+    }
+    return std::distance(chunks.begin(), it);
+  }
+
+  ast::Namespace* current_namespace() {
+    return std::get_if<ast::Namespace>(&get_current_code_fragment());
+  }
+
+  /**
+   * Add the functions of the same chunk of the previous version, false if
+   * there is none
+   */
+  bool reuse(Chunk const& chunk, std::uint16_t row, std::uint16_t col) {
+    auto text = content.substr(chunk.begin, chunk.end - chunk.begin);
+    // NOTE: the Source counts the column from the start of the last advance
+    // without a new line, so only the first declaration of a chunk without
+    // leading whitespace has the column it starts at
+    bool same_columns = std::isspace(static_cast<unsigned char>(text.front()));
+    auto [begin, end] = previous_chunks.equal_range(chunk.hash);
+    for (auto it = begin; it != end; ++it) {
+      auto& old = previous.chunks[it->second];
+      auto old_text = std::string_view{previous.content}.substr(
+          old.chunk.begin, old.chunk.end - old.chunk.begin);
+      if ((old.col != col && !same_columns) || old_text != text) {
+        continue;
+      }
+
+      Relocator relocator{row - old.row};
+      if (old.row != row) {
+        relocator.walk(old.functions);
+      }
+      if (!relocator.complete) {
+        previous_chunks.erase(it);
+        return false;
+      }
+
+      auto& n = *current_namespace();
+      for (auto& function : old.functions) {
+        n.add_function(ast::Function{function});
+      }
+      current.chunks.push_back({chunk, row, col, std::move(old.functions)});
+      previous_chunks.erase(it);
+      ++reused;
+      return true;
+    }
+    return false;
+  }
+
+  /**
+   * Keep the functions of the recorded chunk once it is parsed to its end
+   */
+  void record() {
+    auto& chunk = chunks[recording->chunk];
+    if (covered_to < chunk.end) {
+      return;
+    }
+
+    auto* n = current_namespace();
+    if (covered_to == chunk.end && n &&
+        get_all_code_fragments().size() == recording->depth) {
+      auto& fragments = n->get_all_code_fragments();
+      ReusableChunk reusable{chunk, recording->row, recording->col, {}};
+      for (auto i = recording->fragments; i < fragments.size(); ++i) {
+        auto* function = std::get_if<ast::Function>(&fragments[i]);
+        if (!function) {
+          reusable.functions.clear();
+          break;
+        }
+        reusable.functions.push_back(*function);
+      }
+      if (!reusable.functions.empty()) {
+        current.chunks.push_back(std::move(reusable));
+      }
+    }
+    recording.reset();
+  }
+
+  void publish() {
+    if (!active) {
+      return;
+    }
+    active = false;
+    std::lock_guard lock{versions_mutex};
+    versions.insert_or_assign(path, std::move(current));
+  }
+
+ public:
+  explicit ReusingStdParser(Parent&) {}
+
+  /**
+   * Take the previous version of the source
+   */
+  void start_source(std::string_view source_path, std::string_view source) {
+    if (!reuse_enabled) {
+      return;
+    }
+
+    auto split_chunks = split(source);
+    active = split_chunks.has_value();
+    if (!active) {
+      return;
+    }
+
+    path = std::filesystem::absolute(source_path).string();
+    content = source;
+    chunks = std::move(*split_chunks);
+    {
+      std::lock_guard lock{versions_mutex};
+      auto it = versions.find(path);
+      previous = it != versions.end() ? std::move(it->second) : Version{};
+    }
+    previous_chunks.clear();
+    for (std::size_t i = 0; i < previous.chunks.size(); ++i) {
+      previous_chunks.emplace(previous.chunks[i].chunk.hash, i);
+    }
+    current = Version{std::string{source}, {}};
+    covered_to = 0;
+    recording.reset();
+    reused = 0;
+  }
+
+  /**
+   * How many chunks of the last source were reused
+   */
+  std::size_t get_reused_chunks() const { return reused; }
+
+  void finish_process() { publish(); }
+
+  void finish_preprocess() { publish(); }
+
+  template <class Source>
+  auto parse(Source& source) {
+    using Out = decltype(StdParser::parse(source));
+    if (!active || source.begin() == source.end()) {
+      return StdParser::parse(source);
+    }
+
+    std::size_t position = std::distance(content.data(), &*source.begin());
+    // NOTE: another parser processed the source since the last position
+    if (position != covered_to) {
+      recording.reset();
+    }
+
+    auto chunk = chunk_at(position);
+    if (chunk && current_namespace()) {
+      auto& c = chunks[*chunk];
+      auto row = source.get_row();
+      auto col = source.get_column();
+      if (reuse(c, row, col)) {
+        covered_to = c.end;
+        auto size = c.end - c.begin;
+        return Out{Result{std::next(source.begin(), size),
+                          std::string_view{&*source.begin(), size}}};
+      }
+      if (!has_local_types(content.substr(c.begin, c.end - c.begin))) {
+        recording = Recording{*chunk, row, col,
+                              get_all_code_fragments().size(),
+                              current_namespace()->get_all_code_fragments().size()};
+      }
+    }
+
+    auto out = StdParser::parse(source);
+    if (!out) {
+      recording.reset();
+      return out;
+    }
+    covered_to = position + std::distance(source.begin(), out->processed_to);
+    if (recording) {
+      record();
+    }
+    return out;
+  }
+};
+}  // namespace std_parser::incremental
+
+#endif  // INCREMENTAL_PARSER_H
@@ -0,0 +1,225 @@
+#ifndef JOBSERVER_H
+#define JOBSERVER_H
+
+#include <cerrno>
+#include <cstdlib>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+/**
+ * Client of the GNU make jobserver, also used by Ninja, so the threads of
+ * main only use the job slots given by the build and a -j of the build
+ * is not exceeded
+ */
+namespace jobserver {
+class Client;
+
+/**
+ * A job slot, given back to the jobserver when destroyed
+ */
+class Token {
+  Client* client = nullptr;
+  // the byte read from the jobserver, empty without a jobserver
+  std::optional<char> byte;
+
+ public:
+  Token() = default;
+  Token(Client* client, std::optional<char> byte)
+      : client{client}, byte{byte} {}
+
+  Token(Token&& t) : client{t.client}, byte{t.byte} { t.client = nullptr; }
+  Token& operator=(Token&& t);
+  Token(Token const&) = delete;
+  Token& operator=(Token const&) = delete;
+
+  ~Token();
+};
+
+/**
+ * Reads the jobserver from MAKEFLAGS, either the pipe given as
+ * --jobserver-auth=R,W (--jobserver-fds with make before 4.2) or the fifo
+ * given as --jobserver-auth=fifo:PATH since make 4.4
+ *
+ * Every process run by the build holds one implicit token, it is the one
+ * of the main thread which is already running, the other threads read one
+ * byte per token from the jobserver and write it back once done. Without a
+ * jobserver the tokens are not limited.
+ */
+class Client {
+  int read_fd = -1;
+  int write_fd = -1;
+  // NOTE: a pipe inherited from make is shared with the other jobs so it
+  // can't be made non blocking, its read may then wait for another job
+  bool blocking_read = false;
+
+  /**
+   * The value of the last jobserver option in the flags, make passes the
+   * ones of the parent makes first
+   */
+  static std::optional<std::string> find_auth(std::string_view flags) {
+    std::optional<std::string> auth;
+    while (!flags.empty()) {
+      auto end = flags.find(' ');
+      auto flag = flags.substr(0, end);
+      flags.remove_prefix(end == std::string_view::npos ? flags.size()
+                                                        : end + 1);
+      for (std::string_view option :
+           {"--jobserver-auth=", "--jobserver-fds="}) {
+        if (flag.substr(0, option.size()) == option) {
+          auth = flag.substr(option.size());
+        }
+      }
+    }
+    return auth;
+  }
+
+  void open(std::string const& auth) {
+#if defined(__unix__) || defined(__APPLE__)
+    std::string_view fifo = "fifo:";
+    if (auth.compare(0, fifo.size(), fifo) == 0) {
+      read_fd = ::open(auth.c_str() + fifo.size(),
+                       O_RDWR | O_NONBLOCK | O_CLOEXEC);
+      write_fd = read_fd;
+      return;
+    }
+
+    auto comma = auth.find(',');
+    if (comma == std::string::npos) {
+      return;
+    }
+    int r = std::atoi(auth.c_str());
+    int w = std::atoi(auth.c_str() + comma + 1);
+    // NOTE: make doesn't pass the pipe to the commands not marked as
+    // recursive, the numbers are then stale
+    if (r < 0 || w < 0 || fcntl(r, F_GETFD) == -1 ||
+        fcntl(w, F_GETFD) == -1) {
+      return;
+    }
+
+    // reopen the pipe for a non blocking read of our own where possible
+    auto path = "/proc/self/fd/" + std::to_string(r);
+    read_fd = ::open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (read_fd == -1) {
+      read_fd = r;
+      blocking_read = true;
+    }
+    write_fd = w;
+#endif
+  }
+
+  std::optional<char> read_byte() {
+#if defined(__unix__) || defined(__APPLE__)
+    if (blocking_read) {
+      pollfd fd{read_fd, POLLIN, 0};
+      if (poll(&fd, 1, 0) != 1) {
+        return std::nullopt;
+      }
+    }
+    char byte;
+    if (read(read_fd, &byte, 1) == 1) {
+      return byte;
+    }
+#endif
+    return std::nullopt;
+  }
+
+  void wait_readable() {
+#if defined(__unix__) || defined(__APPLE__)
+    // NOTE: with a timeout as a blocking read may be taken by another job
+    pollfd fd{read_fd, POLLIN, 0};
+    poll(&fd, 1, 10);
+#endif
+  }
+
+ public:
+  explicit Client(std::string_view makeflags) {
+    if (auto auth = find_auth(makeflags)) {
+      open(*auth);
+    }
+  }
+
+  Client(Client const&) = delete;
+  Client& operator=(Client const&) = delete;
+
+  ~Client() {
+#if defined(__unix__) || defined(__APPLE__)
+    if (!blocking_read && read_fd != -1) {
+      close(read_fd);
+    }
+#endif
+  }
+
+  /**
+   * The jobserver of the build running main, from MAKEFLAGS
+   */
+  static Client& get() {
+    auto flags = std::getenv("MAKEFLAGS");
+    static Client client{flags ? flags : ""};
+    return client;
+  }
+
+  bool ok() const { return read_fd != -1 && write_fd != -1; }
+
+  /**
+   * A token for a thread besides the main one if one is free right away
+   */
+  std::optional<Token> try_acquire() {
+    if (!ok()) {
+      return Token{};
+    }
+    if (auto byte = read_byte()) {
+      return Token{this, byte};
+    }
+    return std::nullopt;
+  }
+
+  /**
+   * Wait for a token
+   */
+  Token acquire() {
+    while (true) {
+      if (auto token = try_acquire()) {
+        return std::move(*token);
+      }
+      wait_readable();
+    }
+  }
+
+  void release(std::optional<char> byte) {
+    if (!byte) {
+      return;
+    }
+#if defined(__unix__) || defined(__APPLE__)
+    while (write(write_fd, &*byte, 1) == -1 && errno == EINTR) {
+    }
+#endif
+  }
+};
+
+inline Token& Token::operator=(Token&& t) {
+  if (this != &t) {
+    if (client) {
+      client->release(byte);
+    }
+    client = t.client;
+    byte = t.byte;
+    t.client = nullptr;
+  }
+  return *this;
+}
+
+inline Token::~Token() {
+  if (client) {
+    client->release(byte);
+  }
+}
+}  // namespace jobserver
+
+#endif  //! JOBSERVER_H
@@ -1,11 +1,15 @@
 #ifndef PREPROCESSOR_H
 #define PREPROCESSOR_H
 
+#include <chrono>
 #include <cstddef>
+#include <deque>
 #include <functional>
+#include <future>
 #include <iostream>
 #include <memory>
 #include <optional>
+#include <string>
 #include <tuple>
 #include <type_traits>
 #include <unordered_set>
@@ -13,6 +17,7 @@
 #include <variant>
 #include <vector>
 
+#include <alloc_stats.hpp>
 #include <detect.hpp>
 #include <error_reporter.hpp>
 #include <result.hpp>
@@ -109,7 +114,10 @@ class Preprocessor {
    */
   template <int N = 0, typename Source, typename Writer>
   auto process(Source& source, Writer& writer) {
-    auto out = std::get<N>(parsers).parse(source);
+    auto out = [&] {
+      ALLOC_STATS_SCOPE(alloc_stats::type_name<parser_type<N>>() + "::parse");
+      return std::get<N>(parsers).parse(source);
+    }();
     if (out) {
       writer(out->result);
       return out->processed_to;
@@ -140,7 +148,11 @@ class Preprocessor {
   template <int N = 0, typename Source>
   auto preprocess(Source& source) {
     if constexpr (is_detected_v<preprocess_fun, parser_type<N>, Source&>) {
-      auto out = std::get<N>(parsers).preprocess(source);
+      auto out = [&] {
+        ALLOC_STATS_SCOPE(alloc_stats::type_name<parser_type<N>>() +
+                          "::preprocess");
+        return std::get<N>(parsers).preprocess(source);
+      }();
       if (out) {
         return out->processed_to;
       }
@@ -152,7 +164,11 @@ class Preprocessor {
     }
 
     constexpr int parser_idx = get_parsers_idx_with_error<std_parser_id>();
-    auto out = std::get<parser_idx>(parsers).parse(source);
+    auto out = [&] {
+      ALLOC_STATS_SCOPE(alloc_stats::type_name<parser_type<parser_idx>>() +
+                        "::parse");
+      return std::get<parser_idx>(parsers).parse(source);
+    }();
     if (out) {
       return out->processed_to;
     }
@@ -177,6 +193,26 @@ class Preprocessor {
     }
   }
 
+  template <class T>
+  using finish_process_fun = decltype(std::declval<T>().finish_process());
+
+  /**
+   * Call finish_process on all parsers that have one
+   *
+   * Called once the whole source is parsed but before waiting for the
+   * deferred outputs, so parsers can send any work they were collecting
+   */
+  template <int N = 0>
+  void finish_process() {
+    if constexpr (is_detected_v<finish_process_fun, parser_type<N>>) {
+      std::get<N>(parsers).finish_process();
+    }
+
+    if constexpr (N + 1 < number_of_parsers) {
+      finish_process<N + 1>();
+    }
+  }
+
   template <class T>
   using start_preprocess_fun = decltype(
       std::declval<T>().start_preprocess(std::declval<std::string_view>()));
@@ -195,6 +231,36 @@ class Preprocessor {
     }
   }
 
+  template <class T>
+  using start_source_fun = decltype(std::declval<T>().start_source(
+      std::declval<std::string_view>(), std::declval<std::string_view>()));
+
+  /**
+   * Call start_source on all parsers that have one with the path and the
+   * content of the source about to be parsed
+   *
+   * NOTE: the content is the one the source iterates over
+   */
+  template <int N = 0>
+  void start_source(std::string_view source_path, std::string_view content) {
+    if constexpr (is_detected_v<start_source_fun, parser_type<N>>) {
+      std::get<N>(parsers).start_source(source_path, content);
+    }
+
+    if constexpr (N + 1 < number_of_parsers) {
+      start_source<N + 1>(source_path, content);
+    }
+  }
+
+  template <typename Source>
+  static std::string_view content_of(Source& source) {
+    if (source.is_finished()) {
+      return {};
+    }
+    std::size_t size = std::distance(source.begin(), source.end());
+    return {&*source.begin(), size};
+  }
+
   template <class T>
   using get_prepend_fun = decltype(std::declval<T>().get_prepend());
 
@@ -236,6 +302,42 @@ class Preprocessor {
     }
   }
 
+  /**
+   * Write the output, or queue it if it has to wait for deferred output
+   */
+  template <typename Writer, typename Output>
+  void write_output(Writer& writer, Output& out) {
+    if (pending_output.empty()) {
+      writer(out);
+    } else {
+      pending_output.emplace_back(std::string(out.begin(), out.end()));
+    }
+  }
+
+  /**
+   * Write the queued output in order until the first deferred output
+   * that is not ready yet, or wait for all of it if wait_all is set
+   */
+  template <typename Writer>
+  void flush_output(Writer& writer, bool wait_all) {
+    while (!pending_output.empty()) {
+      auto& front = pending_output.front();
+      if (auto* deferred = std::get_if<std::future<std::string>>(&front)) {
+        bool ready = deferred->wait_for(std::chrono::seconds(0)) ==
+                     std::future_status::ready;
+        if (!wait_all && !ready) {
+          return;
+        }
+
+        auto out = deferred->get();
+        writer(out);
+      } else {
+        writer(std::get<std::string>(front));
+      }
+      pending_output.pop_front();
+    }
+  }
+
   // Data members
   source::SourceLoader source_loader;
   ErrorReporter reporter;
@@ -243,6 +345,10 @@ class Preprocessor {
 
   std::string current_file_name;
 
+  // output of the current source waiting on a deferred output before it
+  std::deque<std::variant<std::string, std::future<std::string>>>
+      pending_output;
+
  public:
   Preprocessor(source::SourceLoader&& loader, Functions... funs)
       : source_loader{std::move(loader)}, parsers{funs(*this)...} {
@@ -260,6 +366,16 @@ class Preprocessor {
 
   auto const& get_current_file_name() const { return current_file_name; }
 
+  /**
+   * Write the output in the place of the current position in the output
+   * once it is ready, the output after it will wait for it
+   *
+   * Used by parsers to continue processing while waiting on a slow output
+   */
+  void defer_output(std::future<std::string>&& output) {
+    pending_output.emplace_back(std::move(output));
+  }
+
   /**
    * Send the source through the parsers for processing until it is finished
    *
@@ -270,9 +386,14 @@ class Preprocessor {
   void process_source(std::string_view source_name, Writer& writer) {
     auto source = source_loader.load_source(source_name);
     current_file_name = source_name;
+    start_source(source_name, content_of(source));
     prepend_to_file(writer);
+    auto ordered_writer = [this, &writer](auto& out) {
+      write_output(writer, out);
+    };
     while (!source.is_finished()) {
-      auto processed_to = process(source, writer);
+      auto processed_to = process(source, ordered_writer);
+      flush_output(writer, false);
 
       std::size_t processed_chars = std::distance(source.begin(), processed_to);
       if (processed_chars == 0) {
@@ -281,6 +402,9 @@ class Preprocessor {
 
       source.advance(processed_chars);
     }
+
+    finish_process();
+    flush_output(writer, true);
   }
 
   /**
@@ -329,6 +453,7 @@ class Preprocessor {
   void preprocess_source(std::string_view source_path) {
     auto source = source_loader.load_source(source_path);
     auto source_name = source::get_source_name(source_path);
+    start_source(source_path, content_of(source));
     start_preprocess(source_name);
     while (!source.is_finished()) {
       auto processed_to = preprocess(source);
@@ -0,0 +1,401 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <climits>
+#include <condition_variable>
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/**
+ * The preprocessor server and its client talk over a Unix domain socket
+ *
+ * The client sends the build id of its main, its working directory and its
+ * arguments, the server runs the stage in its own process, with its caches
+ * already warm, and sends back the output and the errors of the stage and
+ * its exit code. A server of another build of main doesn't answer, so the
+ * client runs main itself, and restarts when its own executable changed.
+ *
+ * Every message is a sequence of strings, each one prefixed by its length
+ */
+namespace server {
+constexpr std::string_view socket_env = "ZERO_PREPROCESSOR_SOCKET";
+constexpr std::string_view shutdown_request = "--shutdown";
+// returned by serve() when the executable of the server was rebuilt
+constexpr int restart = 2;
+
+/**
+ * The path, the modification time and the size of the executable, empty if
+ * it doesn't exist
+ */
+inline std::string build_id(std::string const& exe) {
+  char path[PATH_MAX];
+  struct stat info;
+  if (!::realpath(exe.c_str(), path) || ::stat(path, &info) != 0) {
+    return {};
+  }
+  return std::string{path} + ':' + std::to_string(info.st_mtim.tv_sec) + '.' +
+         std::to_string(info.st_mtim.tv_nsec) + ':' +
+         std::to_string(info.st_size);
+}
+
+/**
+ * Forwards std::cout or std::cerr to the buffer the current thread
+ * redirected it to, so the requests run at the same time each write to
+ * their own client
+ *
+ * NOTE: unbuffered, every write goes to the buffer of the thread
+ */
+class ThreadOutput : public std::streambuf {
+  std::ostream& stream;
+  std::streambuf* fallback;
+  inline static thread_local std::streambuf* targets[2] = {nullptr, nullptr};
+  int index;
+
+  std::streambuf* target() {
+    return targets[index] ? targets[index] : fallback;
+  }
+
+ protected:
+  int_type overflow(int_type c) override {
+    if (traits_type::eq_int_type(c, traits_type::eof())) {
+      return traits_type::not_eof(c);
+    }
+    return target()->sputc(traits_type::to_char_type(c));
+  }
+
+  std::streamsize xsputn(char const* s, std::streamsize n) override {
+    return target()->sputn(s, n);
+  }
+
+  int sync() override { return target()->pubsync(); }
+
+ public:
+  /**
+   * Install it as the buffer of std::cout or std::cerr
+   */
+  explicit ThreadOutput(std::ostream& stream)
+      : stream{stream},
+        fallback{stream.rdbuf()},
+        index{&stream == &std::cerr ? 1 : 0} {
+    stream.rdbuf(this);
+  }
+
+  ThreadOutput(ThreadOutput const&) = delete;
+  ThreadOutput& operator=(ThreadOutput const&) = delete;
+
+  ~ThreadOutput() { stream.rdbuf(fallback); }
+
+  /**
+   * Redirect the stream on the current thread, nullptr to undo it
+   */
+  void redirect(std::streambuf* buffer) { targets[index] = buffer; }
+};
+
+/**
+ * The socket given by the environment, else the one of the build directory
+ * given when building or the one in the working directory
+ */
+inline std::string default_socket_path() {
+  if (auto path = std::getenv(socket_env.data()); path && *path) {
+    return path;
+  }
+#ifdef ZERO_PREPROCESSOR_SOCKET_PATH
+  return ZERO_PREPROCESSOR_SOCKET_PATH;
+#else
+  return "zero_preprocessor.sock";
+#endif
+}
+
+inline bool write_all(int fd, char const* data, std::size_t size) {
+  while (size > 0) {
+    auto written = ::write(fd, data, size);
+    if (written <= 0) {
+      return false;
+    }
+    data += written;
+    size -= written;
+  }
+  return true;
+}
+
+inline bool read_all(int fd, char* data, std::size_t size) {
+  while (size > 0) {
+    auto read = ::read(fd, data, size);
+    if (read <= 0) {
+      return false;
+    }
+    data += read;
+    size -= read;
+  }
+  return true;
+}
+
+inline bool send_string(int fd, std::string_view s) {
+  auto size = static_cast<std::uint32_t>(s.size());
+  return write_all(fd, reinterpret_cast<char const*>(&size), sizeof(size)) &&
+         write_all(fd, s.data(), s.size());
+}
+
+inline std::optional<std::string> receive_string(int fd) {
+  std::uint32_t size = 0;
+  if (!read_all(fd, reinterpret_cast<char*>(&size), sizeof(size))) {
+    return std::nullopt;
+  }
+  std::string s(size, '\0');
+  if (!read_all(fd, s.data(), size)) {
+    return std::nullopt;
+  }
+  return s;
+}
+
+inline std::optional<sockaddr_un> make_address(std::string const& path) {
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  // NOTE: the path has to fit with its terminating null
+  if (path.size() >= sizeof(address.sun_path)) {
+    return std::nullopt;
+  }
+  path.copy(address.sun_path, path.size());
+  return address;
+}
+
+/**
+ * Connect to the server, -1 if there is no server on the socket
+ */
+inline int connect_to(std::string const& path) {
+  auto address = make_address(path);
+  if (!address) {
+    return -1;
+  }
+
+  int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    return -1;
+  }
+  if (::connect(fd, reinterpret_cast<sockaddr*>(&*address),
+                sizeof(*address)) != 0) {
+    ::close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+/**
+ * Run the arguments on the server of the build of main with the build id
+ * and write its output to out and its errors to err
+ *
+ * Returns the exit code of the stage, empty if no server is running, it
+ * runs another build of main or it stopped before answering, so the stage
+ * can be run in process instead
+ */
+inline std::optional<int> run_remote(std::string const& path,
+                                     std::string const& build,
+                                     std::vector<std::string> const& args,
+                                     std::ostream& out, std::ostream& err) {
+  int fd = connect_to(path);
+  if (fd < 0) {
+    return std::nullopt;
+  }
+
+  std::optional<int> code;
+  char cwd[4096];
+  bool sent = ::getcwd(cwd, sizeof(cwd)) && send_string(fd, build) &&
+              send_string(fd, cwd) &&
+              send_string(fd, std::to_string(args.size()));
+  for (std::size_t i = 0; sent && i < args.size(); ++i) {
+    sent = send_string(fd, args[i]);
+  }
+
+  if (sent) {
+    auto output = receive_string(fd);
+    auto errors = output ? receive_string(fd) : std::nullopt;
+    auto exit_code = errors ? receive_string(fd) : std::nullopt;
+    if (exit_code) {
+      out << *output << std::flush;
+      err << *errors << std::flush;
+      code = std::atoi(exit_code->c_str());
+    }
+  }
+
+  ::close(fd);
+  return code;
+}
+
+struct Request {
+  std::string build;
+  std::string cwd;
+  std::vector<std::string> args;
+};
+
+inline std::optional<Request> receive_request(int fd) {
+  auto build = receive_string(fd);
+  auto cwd = build ? receive_string(fd) : std::nullopt;
+  auto count = cwd ? receive_string(fd) : std::nullopt;
+  if (!count) {
+    return std::nullopt;
+  }
+
+  Request request{std::move(*build), std::move(*cwd), {}};
+  for (int i = 0, n = std::atoi(count->c_str()); i < n; ++i) {
+    auto arg = receive_string(fd);
+    if (!arg) {
+      return std::nullopt;
+    }
+    request.args.push_back(std::move(*arg));
+  }
+  return request;
+}
+
+/**
+ * Serve the requests until a shutdown request, or until a client of another
+ * build comes once the executable of the server was rebuilt, then restart
+ * is returned so the new build can take over
+ *
+ * The handler is called in the client's working directory with the
+ * client's arguments and the streams for the output and the errors, and
+ * returns the exit code
+ *
+ * NOTE: on Linux every request runs on its own thread with a working
+ * directory of its own, so the stages of a parallel build run at the same
+ * time as with plain main. Elsewhere the working directory is shared by the
+ * whole process and the requests are run one after the other.
+ */
+template <class Handler>
+int serve(std::string const& path, std::string const& exe,
+          Handler&& handler) {
+  auto address = make_address(path);
+  if (!address) {
+    std::cerr << "the socket path " << path << " is too long\n";
+    return 1;
+  }
+
+  if (int fd = connect_to(path); fd >= 0) {
+    ::close(fd);
+    std::cerr << "a server is already running on " << path << '\n';
+    return 1;
+  }
+  // the socket left behind by a server that is not running anymore
+  ::unlink(path.c_str());
+
+  int listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listener < 0 ||
+      ::bind(listener, reinterpret_cast<sockaddr*>(&*address),
+             sizeof(*address)) != 0 ||
+      ::listen(listener, 64) != 0) {
+    std::cerr << "can't listen on " << path << '\n';
+    return 1;
+  }
+
+  // NOTE: a client that went away must not kill the server
+  std::signal(SIGPIPE, SIG_IGN);
+
+  auto run = [&handler](int fd, Request request, bool own_directory) {
+    std::ostringstream output;
+    std::ostringstream errors;
+    int code = 1;
+    char server_cwd[4096];
+    if (!own_directory && !::getcwd(server_cwd, sizeof(server_cwd))) {
+      errors << "can't get the working directory of the server\n";
+    } else if (::chdir(request.cwd.c_str()) == 0) {
+      code = handler(request.args, output, errors);
+      // NOTE: relative paths of the server itself stay valid
+      if (!own_directory && ::chdir(server_cwd) != 0) {
+        std::cerr << "can't change back to " << server_cwd << '\n';
+        std::abort();
+      }
+    } else {
+      errors << "can't change the working directory to " << request.cwd
+             << '\n';
+    }
+
+    send_string(fd, output.str()) && send_string(fd, errors.str()) &&
+        send_string(fd, std::to_string(code));
+    ::close(fd);
+  };
+
+  std::mutex mutex;
+  std::condition_variable finished;
+  std::size_t running_requests = 0;
+  std::string build = build_id(exe);
+  int code = 0;
+  bool running = true;
+  while (running) {
+    int fd = ::accept(listener, nullptr, nullptr);
+    if (fd < 0) {
+      continue;
+    }
+
+    auto request = receive_request(fd);
+    if (!request) {
+      ::close(fd);
+      continue;
+    }
+
+    if (request->args.size() > 1 && request->args[1] == shutdown_request) {
+      send_string(fd, "") && send_string(fd, "") && send_string(fd, "0");
+      ::close(fd);
+      running = false;
+      continue;
+    }
+
+    if (request->build != build) {
+      // NOTE: not answered so the client runs its own main
+      ::close(fd);
+      if (build_id(exe) != build) {
+        code = restart;
+        running = false;
+      }
+      continue;
+    }
+
+#ifdef __linux__
+    {
+      std::lock_guard lock{mutex};
+      ++running_requests;
+    }
+    std::thread{[&, fd, request = std::move(*request)]() mutable {
+      // NOTE: the working directory of this thread only
+      bool own_directory = ::unshare(CLONE_FS) == 0;
+      if (own_directory) {
+        run(fd, std::move(request), true);
+      } else {
+        std::lock_guard lock{mutex};
+        run(fd, std::move(request), false);
+      }
+      std::lock_guard lock{mutex};
+      --running_requests;
+      finished.notify_all();
+    }}.detach();
+#else
+    run(fd, std::move(*request), false);
+#endif
+  }
+
+  ::close(listener);
+  ::unlink(path.c_str());
+  std::unique_lock lock{mutex};
+  finished.wait(lock, [&] { return running_requests == 0; });
+  return code;
+}
+}  // namespace server
+
+#endif  // SERVER_H
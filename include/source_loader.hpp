@@ -1,9 +1,18 @@
 #ifndef SOURCE_LOADER_H
 #define SOURCE_LOADER_H
+#include <cstdint>
 #include <filesystem>
 #include <fstream>
+#include <functional>
 #include <iostream>
+#include <mutex>
 #include <optional>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 #include <source.hpp>
 
@@ -27,6 +36,42 @@ void check_out_dir(fs::path out) {
   }
 }
 
+/**
+ * Write the content to a temporary file first and rename it over the file
+ * so readers never see a partial file
+ */
+void write_atomic(fs::path const& path, std::string_view content) {
+  check_out_dir(path);
+  // NOTE: per thread as the sources processed in parallel can share headers
+  auto tmp = path;
+  tmp += ".tmp" + std::to_string(
+                    std::hash<std::thread::id>{}(std::this_thread::get_id()));
+  {
+    std::ofstream out(tmp, std::ios::binary);
+    out << content;
+  }
+  fs::rename(tmp, path);
+}
+
+/**
+ * Write the content to the file only if it differs from the current one,
+ * leaving the file's timestamp untouched otherwise
+ */
+void write_if_changed(fs::path const& path, std::string_view content) {
+  {
+    std::ifstream in(path, std::ios::binary);
+    if (in.is_open()) {
+      std::string current((std::istreambuf_iterator<char>(in)),
+                          (std::istreambuf_iterator<char>()));
+      if (current == content) {
+        return;
+      }
+    }
+  }
+
+  write_atomic(path, content);
+}
+
 /**
  * Check if include is from the standard library
  */
@@ -54,7 +99,59 @@ class SourceLoader {
   std::vector<std::string> include_dirs;
   fs::path out;
 
+  struct CachedSource {
+    fs::file_time_type time;
+    std::uintmax_t size;
+    std::string content;
+  };
+
+  inline static bool cache_sources = false;
+  // NOTE: shared by the sources processed in parallel
+  inline static std::mutex sources_mutex;
+  inline static std::unordered_map<std::string, CachedSource> sources;
+
+  /**
+   * The content of the file from the cache if it didn't change since it
+   * was read
+   */
+  std::optional<std::string> find_cached(fs::path const& in) {
+    std::error_code e;
+    auto time = fs::last_write_time(in, e);
+    auto size = e ? 0 : fs::file_size(in, e);
+    if (e) {
+      return std::nullopt;
+    }
+
+    // NOTE: absolute since the server runs the stages in the directories
+    // of their clients
+    auto key = fs::absolute(in, e).string();
+    {
+      std::lock_guard lock{sources_mutex};
+      auto it = sources.find(key);
+      if (it != sources.end() && it->second.time == time &&
+          it->second.size == size) {
+        return it->second.content;
+      }
+    }
+
+    std::ifstream in_file(in.c_str(), std::ios::binary);
+    if (!in_file.is_open()) {
+      return std::nullopt;
+    }
+    std::string content((std::istreambuf_iterator<char>(in_file)),
+                        (std::istreambuf_iterator<char>()));
+    std::lock_guard lock{sources_mutex};
+    sources.insert_or_assign(key, CachedSource{time, size, content});
+    return content;
+  }
+
  public:
+  /**
+   * Keep the loaded sources in memory for the next runs of a resident
+   * preprocessor, a source is read again once its file changes
+   */
+  static void enable_cache() { cache_sources = true; }
+
   SourceLoader(std::vector<std::string>&& include_dirs, fs::path out)
       : include_dirs{std::move(include_dirs)}, out{out} {}
 
@@ -83,10 +180,16 @@ class SourceLoader {
   }
 
   Source load_source(fs::path in) {
+    if (cache_sources) {
+      if (auto content = find_cached(in)) {
+        return {*content, in.string()};
+      }
+    }
+
     std::ifstream in_file(in.c_str());
     if (!in_file.is_open()) {
-      std::cerr << in << " file can't be oppened" << std::endl;
-      std::terminate();
+      // NOTE: thrown so a resident preprocessor only fails the current run
+      throw std::runtime_error(in.string() + " file can't be oppened");
     }
 
     // TODO: for now load the entire file, make it better later
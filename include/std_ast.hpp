@@ -664,6 +664,10 @@ class Scope {
   }
 
   auto get_class(const std::string& name) const { return classes.at(name); }
+
+  auto const& get_all_classes() const { return classes; }
+
+  auto const& get_all_variables() const { return variables; }
 };
 
 struct IfStatement {
@@ -695,6 +699,8 @@ class Namespace {
   Namespace(const std::string& name) : name{name} {}
   Namespace(std::string&& name) : name{std::move(name)} {}
 
+  auto const& get_name() const { return name; }
+
   auto const& get_all_code_fragments() const { return code_fragments; }
 
   void add_user_deduction_guide(UserDeductionGuide&& udg) {
@@ -739,6 +745,10 @@ class Namespace {
   }
 
   void add_namespace(Namespace&& n) { code_fragments.push_back(std::move(n)); }
+
+  void add_code_fragment(CodeFragment&& fragment) {
+    code_fragments.push_back(std::move(fragment));
+  }
 };
 } // namespace std_parser::rules::ast
 
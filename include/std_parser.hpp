@@ -7,6 +7,7 @@
 #include <unordered_set>
 #include <variant>
 
+#include <alloc_stats.hpp>
 #include <detect.hpp>
 #include <overloaded.hpp>
 #include <result.hpp>
@@ -91,6 +92,7 @@ class StdParserState {
   template<class Source>
   ParseResult<Source> parse_inside_namespace(Source& source,
                                              rules::ast::Namespace& current) {
+    ALLOC_STATS_SCOPE("StdParser::parse_inside_namespace");
     auto begin = source.begin();
     auto end = source.end();
 
@@ -184,6 +186,7 @@ class StdParserState {
   template<class Source>
   ParseResult<Source> parse_inside_class(Source& source,
                                          rules::ast::Class& current) {
+    ALLOC_STATS_SCOPE("StdParser::parse_inside_class");
     auto begin = source.begin();
     auto end = source.end();
 
@@ -253,6 +256,7 @@ class StdParserState {
   template<class Source>
   ParseResult<Source> parse_inside_enum(Source& source,
                                         rules::ast::Enumeration& current) {
+    ALLOC_STATS_SCOPE("StdParser::parse_inside_enum");
     auto begin = source.begin();
     auto end = source.end();
 
@@ -282,6 +286,7 @@ class StdParserState {
   template<class Source>
   ParseResult<Source> parse_inside_expression(Source& source,
                                               rules::ast::Expression& current) {
+    ALLOC_STATS_SCOPE("StdParser::parse_inside_expression");
     auto begin = source.begin();
     auto end = source.end();
 
@@ -338,6 +343,7 @@ class StdParserState {
   ParseResult<Source>
   parse_inside_round_expression(Source& source,
                                 rules::ast::RoundExpression& current) {
+    ALLOC_STATS_SCOPE("StdParser::parse_inside_round_expression");
     auto begin = source.begin();
     auto end = source.end();
 
@@ -393,6 +399,7 @@ class StdParserState {
   ParseResult<Source>
   parse_inside_curly_expression(Source& source,
                                 rules::ast::CurlyExpression& current) {
+    ALLOC_STATS_SCOPE("StdParser::parse_inside_curly_expression");
     auto begin = source.begin();
     auto end = source.end();
 
@@ -451,6 +458,7 @@ class StdParserState {
 
   template<class Source>
   ParseResult<Source> parse_inside_lambda(Source& source, rules::ast::Lambda&) {
+    ALLOC_STATS_SCOPE("StdParser::parse_inside_lambda");
     auto begin = source.begin();
     auto end = source.end();
 
@@ -515,6 +523,7 @@ class StdParserState {
   template<class Source>
   ParseResult<Source> parse_inside_if_statement(Source& source,
                                                 rules::ast::IfStatement& current) {
+    ALLOC_STATS_SCOPE("StdParser::parse_inside_if_statement");
     auto begin = source.begin();
     auto end = source.end();
 
@@ -648,6 +657,7 @@ class StdParserState {
 
   template<class Source, class Statement>
   ParseResult<Source> parse_inside_statement(Source& source, Statement&) {
+    ALLOC_STATS_SCOPE("StdParser::parse_inside_statement");
     auto begin = source.begin();
     auto end = source.end();
 
@@ -670,6 +680,7 @@ class StdParserState {
   template<class Source>
   ParseResult<Source> parse_inside_var_definition(Source& source,
                                                   rules::ast::Vars& current) {
+    ALLOC_STATS_SCOPE("StdParser::parse_inside_var_definition");
     auto begin = source.begin();
     auto end = source.end();
 
@@ -733,6 +744,7 @@ class StdParserState {
   ParseResult<Source>
   parse_inside_function_declaration(Source& source,
                                     rules::ast::FunctionDeclaration& current) {
+    ALLOC_STATS_SCOPE("StdParser::parse_inside_function_declaration");
     auto begin = source.begin();
     auto end = source.end();
 
@@ -772,6 +784,7 @@ class StdParserState {
   template<class Source>
   ParseResult<Source> parse_inside_params(Source& source,
                                           rules::ast::Params& current) {
+    ALLOC_STATS_SCOPE("StdParser::parse_inside_params");
     auto begin = source.begin();
     auto end = source.end();
 
@@ -872,6 +885,7 @@ class StdParserState {
   template<class Source>
   ParseResult<Source> parse_inside_function(Source& source,
                                             rules::ast::Function& current) {
+    ALLOC_STATS_SCOPE("StdParser::parse_inside_function");
     auto begin = source.begin();
     auto end = source.end();
 
@@ -958,6 +972,7 @@ class StdParserState {
 
   template<class Source>
   ParseResult<Source> parse_inside_scope(Source& source, rules::ast::Scope&) {
+    ALLOC_STATS_SCOPE("StdParser::parse_inside_scope");
     auto begin = source.begin();
     auto end = source.end();
 
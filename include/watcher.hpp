@@ -0,0 +1,109 @@
+#ifndef WATCHER_H
+#define WATCHER_H
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace watch {
+/**
+ * The path used to match the files of the events with the watched files
+ */
+inline std::string normalize(fs::path const& path) {
+  std::error_code e;
+  auto normal = fs::weakly_canonical(path, e);
+  return (e ? path.lexically_normal() : normal).string();
+}
+
+/**
+ * Watches the files for changes with inotify, Linux only
+ *
+ * NOTE: the directories of the files are watched instead of the files
+ * themselves since editors often save by renaming a new file over the old
+ * one, which would end the watch of the file
+ */
+class Watcher {
+  int fd;
+  // directory of each watch descriptor
+  std::unordered_map<int, fs::path> dirs;
+  std::unordered_set<std::string> watched_dirs;
+
+  /**
+   * Read the pending events into the changed files
+   */
+  void read_events(std::unordered_set<std::string>& changed) {
+    alignas(inotify_event) char buffer[4096];
+    auto size = ::read(fd, buffer, sizeof(buffer));
+    for (char* p = buffer; size > 0 && p < buffer + size;) {
+      auto event = reinterpret_cast<inotify_event*>(p);
+      if (auto dir = dirs.find(event->wd); dir != dirs.end() && event->len) {
+        changed.insert((dir->second / event->name).string());
+      }
+      p += sizeof(inotify_event) + event->len;
+    }
+  }
+
+ public:
+  Watcher() : fd{inotify_init1(IN_CLOEXEC)} {}
+
+  Watcher(Watcher const&) = delete;
+  Watcher& operator=(Watcher const&) = delete;
+
+  ~Watcher() {
+    if (fd >= 0) {
+      ::close(fd);
+    }
+  }
+
+  bool ok() const { return fd >= 0; }
+
+  /**
+   * Watch the file for changes, false if its directory can't be watched
+   */
+  bool add(fs::path const& file) {
+    auto dir = fs::path{normalize(file)}.parent_path();
+    if (watched_dirs.count(dir.string())) {
+      return true;
+    }
+
+    int wd = inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (wd < 0) {
+      return false;
+    }
+    dirs.insert_or_assign(wd, dir);
+    watched_dirs.insert(dir.string());
+    return true;
+  }
+
+  /**
+   * Wait for changes and return the normalized paths of the changed files
+   *
+   * The events that come within the settle time of each other are merged,
+   * so a save that writes the file in several steps is only reported once
+   */
+  std::unordered_set<std::string> wait(std::chrono::milliseconds settle) {
+    std::unordered_set<std::string> changed;
+    pollfd poll_fd{fd, POLLIN, 0};
+    if (::poll(&poll_fd, 1, -1) <= 0) {
+      return changed;
+    }
+
+    read_events(changed);
+    while (::poll(&poll_fd, 1, static_cast<int>(settle.count())) > 0) {
+      read_events(changed);
+    }
+    return changed;
+  }
+};
+}  // namespace watch
+
+#endif  // WATCHER_H
@@ -0,0 +1,38 @@
+// The thin client of the preprocessor server used by the custom commands of
+// preprocess(), it takes the same arguments as main
+//
+// The stage is run by the server of the build directory when one is running,
+// started with `main server [socket]`, else main is run in its place, as it
+// is when the server runs another build of main.
+// `client --shutdown` stops the server.
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <unistd.h>
+
+#include <server.hpp>
+
+int main(int argc, char* argv[]) {
+  std::vector<std::string> args(argv, argv + argc);
+  if (auto code = server::run_remote(
+          server::default_socket_path(),
+          server::build_id(ZERO_PREPROCESSOR_MAIN), args, std::cout,
+          std::cerr)) {
+    return *code;
+  }
+
+  // no server to stop
+  if (argc > 1 && std::string_view{argv[1]} == server::shutdown_request) {
+    return 0;
+  }
+
+  // NOTE: run main itself so the output is the same without a server
+  argv[0] = const_cast<char*>(ZERO_PREPROCESSOR_MAIN);
+  execv(argv[0], argv);
+  std::perror(ZERO_PREPROCESSOR_MAIN);
+  return 1;
+}
@@ -1,13 +1,48 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <map>
+#include <new>
+#include <optional>
+#include <thread>
+#include <unordered_set>
 
+#include <alloc_stats.hpp>
+#include <ast_stats.hpp>
+#include <compile_commands.hpp>
+#include <incremental_parser.hpp>
+#include <jobserver.hpp>
 #include <meta_classes.hpp>
 #include <preprocessor.hpp>
+#ifdef ZERO_PREPROCESSOR_SERVER
+#include <server.hpp>
+#endif
 #include <source_loader.hpp>
 #include <static_reflection.hpp>
 #include <std_parser.hpp>
+#ifdef __linux__
+#include <watcher.hpp>
+#endif
 
-int stage_one(int argc, char* argv[]) {
+#ifdef ZERO_PREPROCESSOR_ALLOC_STATS
+// count every allocation for the report of the allocations per phase
+void* operator new(std::size_t size) {
+  alloc_stats::count(size);
+  if (void* p = std::malloc(size == 0 ? 1 : size)) {
+    return p;
+  }
+  throw std::bad_alloc{};
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+#endif
+
+int stage_one(int argc, char* argv[], bool with_stats) {
   source::check_out_dir({argv[3]});
 
   std::vector<std::string> inc_dirs;
@@ -34,6 +69,9 @@ int stage_one(int argc, char* argv[]) {
   };
   preprocessor.get_dependencies(argv[2], writer);
 
+  if (with_stats) {
+    std_parser::ast_stats::report_peak_rss(std::cout, "stage 1");
+  }
   return 0;
 }
 
@@ -42,7 +80,8 @@ auto read_sources(std::string_view file) {
   std::vector<std::pair<std::string, std::string>> sources;
   std::ifstream in_file(file.data());
   std::string first, second;
-  while (in_file >> first >> second) {
+  // NOTE: one path per line as paths may contain spaces
+  while (std::getline(in_file, first) && std::getline(in_file, second)) {
     std::cout << "read: " << first << " , " << second << std::endl;
     sources.emplace_back(std::move(first), std::move(second));
   }
@@ -50,7 +89,7 @@ auto read_sources(std::string_view file) {
   return sources;
 }
 
-int stage_two(int argc, char* argv[]) {
+int stage_two(int argc, char* argv[], bool with_stats) {
   source::check_out_dir({argv[3]});
 
   auto includes = read_sources(argv[3]);
@@ -62,79 +101,190 @@ int stage_two(int argc, char* argv[]) {
 
   source::SourceLoader loader{{}, "include"};
 
-  auto std_parser = [](auto&) { return std_parser::StdParser{}; };
+  // NOTE: reuses the unchanged functions of the previous run when resident
+  auto std_parser = [](auto& parent) {
+    return std_parser::incremental::ReusingStdParser{parent};
+  };
   auto meta_classes = [&](auto& parent) {
     return meta_classes::MetaClassParser{parent, "", argv[4]};
   };
 
-  Preprocessor preprocessor(std::move(loader), meta_classes, std_parser);
+  auto preprocess = [&](auto... parsers) {
+    Preprocessor preprocessor(std::move(loader), parsers...);
+
+    for (auto& source : sources) {
+      std::cout << "preprocessing " << source << std::endl;
+      preprocessor.preprocess_source(source);
+    }
 
-  for (auto& source : sources) {
-    std::cout << "preprocessing " << source << std::endl;
-    preprocessor.preprocess_source(source);
+    if (with_stats) {
+      using P = decltype(preprocessor);
+      auto& parser = preprocessor.template get_parser<P::std_parser_id>();
+      auto stats =
+          std_parser::ast_stats::collect(parser.get_all_code_fragments());
+      std_parser::ast_stats::report(std::cout, "stage 2", stats);
+    }
+  };
+
+  // optionally collect the types named in reflexpr into a file
+  if (argc == 6) {
+    auto static_ref = [&](auto& parent) {
+      return static_reflection::StaticReflexParser{parent, fs::path{argv[5]}};
+    };
+    preprocess(meta_classes, static_ref, std_parser);
+  } else {
+    preprocess(meta_classes, std_parser);
+  }
+
+  if (with_stats) {
+    std_parser::ast_stats::report_peak_rss(std::cout, "stage 2");
   }
 
   return 0;
 }
 
-int stage_three(int argc, char* argv[]) {
-  if (argc != 6) {
+int stage_three(int argc, char* argv[], bool with_stats) {
+  if (argc < 6) {
     return 1;
   }
 
+  // optional directory for caching the generated meta classes between runs
+  std::string_view meta_cache_dir = argc >= 7 ? argv[6] : "";
+
+  // optionally generate binary serializers, soa_vector accessors and
+  // comparisons along with the reflection, only reflect the types collected
+  // in stage two
+  // and move the reflection of the headers to shared headers
+  bool with_serializers = false;
+  bool with_soa = false;
+  bool with_comparisons = false;
+  std::optional<std::unordered_set<std::string>> reflected_types;
+  fs::path shared_reflection_dir;
+  for (int i = 7; i < argc; ++i) {
+    std::string_view flag = argv[i];
+    std::string_view reflected_types_flag = "--reflected-types=";
+    std::string_view shared_reflection_flag = "--shared-reflection=";
+    if (flag == "--serializers") {
+      with_serializers = true;
+    } else if (flag == "--soa") {
+      with_soa = true;
+    } else if (flag == "--comparisons") {
+      with_comparisons = true;
+    } else if (flag.substr(0, reflected_types_flag.size()) ==
+               reflected_types_flag) {
+      flag.remove_prefix(reflected_types_flag.size());
+      reflected_types = static_reflection::read_reflected_types(flag);
+    } else if (flag.substr(0, shared_reflection_flag.size()) ==
+               shared_reflection_flag) {
+      flag.remove_prefix(shared_reflection_flag.size());
+      shared_reflection_dir = flag;
+    } else {
+      std::cout << "unknown flag " << flag << std::endl;
+      return 1;
+    }
+  }
+
   auto sources = read_sources(argv[4]);
   sources.emplace_back(argv[2], argv[3]);
 
   source::SourceLoader loader{{}, "include"};
 
   auto meta_classes = [&](auto& parent) {
-    return meta_classes::MetaClassParser{parent, argv[5], ""};
+    return meta_classes::MetaClassParser{parent, argv[5], "", meta_cache_dir};
   };
 
-  auto static_ref = [](auto& parent) {
-    return static_reflection::StaticReflexParser{parent};
+  auto static_ref = [&](auto& parent) {
+    using Parser = static_reflection::StaticReflexParser<
+        std::remove_reference_t<decltype(parent)>>;
+    return Parser{parent,           Parser::Representation::Flat,
+                  with_serializers, with_soa,
+                  with_comparisons, reflected_types,
+                  shared_reflection_dir};
   };
 
-  auto std_parser = [](auto&) { return std_parser::StdParser{}; };
+  // NOTE: reuses the unchanged functions of the previous run when resident
+  auto std_parser = [](auto& parent) {
+    return std_parser::incremental::ReusingStdParser{parent};
+  };
   Preprocessor preprocessor(std::move(loader), meta_classes, static_ref,
                             std_parser);
 
   for (auto& pair : sources) {
     std::cout << "processing " << pair.first << " into " << pair.second
               << std::endl;
-    source::check_out_dir(pair.second);
-    std::ofstream out_file(pair.second, std::ios::out);
+    std::string out;
     // TODO: need to provide a writer for the processed content
-    auto writer = [&out_file](auto& src) {
-      for (auto& elem : src) {
-        out_file << elem;
-      }
-    };
+    auto writer = [&out](auto& src) { out.append(src.begin(), src.end()); };
     preprocessor.process_source(pair.first, writer);
+    // NOTE: the output is replaced at once so the compiler, or an editor
+    // watching it, never reads a partially written output
+    source::write_atomic(pair.second, out);
+  }
+
+  if (with_stats) {
+    using P = decltype(preprocessor);
+    auto& parser = preprocessor.get_parser<P::std_parser_id>();
+    auto stats = std_parser::ast_stats::collect(parser.get_all_code_fragments());
+    std_parser::ast_stats::report(std::cout, "stage 3", stats);
+    std_parser::ast_stats::report_peak_rss(std::cout, "stage 3");
+  }
+
+  // list the processed headers with their reflection for the shared header
+  // of the target, the header has to come before its reflection
+  if (!shared_reflection_dir.empty()) {
+    std::string list;
+    for (auto& [source, out] : sources) {
+      if (source::is_source(source)) {
+        continue;
+      }
+      list += "#include \"" + out + "\"\n";
+      list += "#include \"" +
+              static_reflection::shared_reflection_path(shared_reflection_dir,
+                                                        source)
+                  .string() +
+              "\"\n";
+    }
+    source::write_if_changed(
+        static_reflection::shared_sources_path(shared_reflection_dir, argv[2]),
+        list);
   }
 
   std::cout << "DONE" << std::endl;
   return 0;
 }
 
-int main(int argc, char* argv[]) {
+int run(int argc, char* argv[]) {
   std::cout << "start\n";
   if (argc == 1) {
     return 1;
   }
 
+  // --stats can be given to any stage to report the memory footprint of
+  // its AST and its peak RSS
+  bool with_stats = false;
+  std::vector<char*> args;
+  for (int i = 0; i < argc; ++i) {
+    if (std::string_view{argv[i]} == "--stats") {
+      with_stats = true;
+    } else {
+      args.push_back(argv[i]);
+    }
+  }
+  argc = static_cast<int>(args.size());
+  argv = args.data();
+
   int stage = std::atoi(argv[1]);
   std::cout << "stage" << stage << "\n";
 
   switch (stage) {
     case 1:
-      return stage_one(argc, argv);
+      return stage_one(argc, argv, with_stats);
       break;
     case 2:
-      return stage_two(argc, argv);
+      return stage_two(argc, argv, with_stats);
       break;
     case 3:
-      return stage_three(argc, argv);
+      return stage_three(argc, argv, with_stats);
       break;
     default:
       return 1;
@@ -142,3 +292,409 @@ int main(int argc, char* argv[]) {
 
   return 0;
 }
+
+/**
+ * Run the stages one after the other with the arguments of main, false if
+ * one of them failed
+ *
+ * NOTE: the errors of a stage only fail its job, nothing escapes to the
+ * worker thread so the other jobs finish and the job slots are given back
+ */
+bool run_stages(std::vector<std::vector<std::string>>& stages) {
+  for (auto& stage : stages) {
+    std::vector<char*> argv;
+    for (auto& arg : stage) {
+      argv.push_back(arg.data());
+    }
+    try {
+      if (run(static_cast<int>(argv.size()), argv.data()) != 0) {
+        return false;
+      }
+    } catch (std::exception const& e) {
+      std::cout << e.what() << std::endl;
+      return false;
+    } catch (...) {
+      std::cout << "unknown error" << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Run the jobs, each a list of stages, on the threads, the number of jobs
+ * that failed
+ *
+ * The main thread runs its jobs in the implicit job slot of main, the other
+ * threads take a token of the jobserver of the build for each job first, so
+ * they only use the job slots left by the build
+ */
+std::size_t run_parallel(
+    std::vector<std::vector<std::vector<std::string>>>& jobs,
+    unsigned threads) {
+  std::atomic<std::size_t> next = 0;
+  std::atomic<std::size_t> failed = 0;
+  auto worker = [&](bool is_main) {
+    while (next < jobs.size()) {
+      std::optional<jobserver::Token> token;
+      if (!is_main) {
+        token = jobserver::Client::get().acquire();
+      }
+      auto i = next++;
+      if (i >= jobs.size()) {
+        return;
+      }
+      if (!run_stages(jobs[i])) {
+        ++failed;
+      }
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for (unsigned i = 1; i < threads; ++i) {
+    workers.emplace_back(worker, false);
+  }
+  worker(true);
+  for (auto& w : workers) {
+    w.join();
+  }
+  return failed;
+}
+
+/**
+ * Run the stages of preprocess() on every source of a compile_commands.json
+ * in parallel into the output directory, for the projects not built with
+ * preprocess()
+ *
+ * main --compile-commands <compile_commands.json> <out dir> [meta exe]
+ *      [-j N] [stage three flags...]
+ *
+ * Without the meta executable only the first two stages run, the meta
+ * executable is then built from the meta_out directory and meta_main.cpp
+ * and given to the next run which also runs the third stage. The sources
+ * sharing their include directories are processed next to each other as
+ * they mostly share their headers, the loaded sources and the meta
+ * processes are shared by all of them
+ */
+int run_compile_commands(int argc, char* argv[]) {
+  if (argc < 4) {
+    std::cout << "usage: main --compile-commands <compile_commands.json> "
+                 "<out dir> [meta exe] [-j N] [flags...]"
+              << std::endl;
+    return 1;
+  }
+
+  fs::path out_dir = fs::absolute(argv[3]);
+  std::string meta_exe;
+  unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<std::string> flags;
+  for (int i = 4; i < argc; ++i) {
+    std::string_view arg = argv[i];
+    if (arg == "-j" && i + 1 < argc) {
+      threads = std::max(1, std::atoi(argv[++i]));
+    } else if (arg.substr(0, 2) == "--") {
+      flags.emplace_back(arg);
+    } else {
+      meta_exe = fs::absolute(arg).string();
+    }
+  }
+
+  auto groups = compile_commands::group_by_include_dirs(
+      compile_commands::read(argv[2]));
+
+  // NOTE: the outputs keep the paths of the sources relative to their
+  // common directory, like the paths relative to the source dir of
+  // preprocess()
+  std::optional<fs::path> root;
+  for (auto& [include_dirs, entries] : groups) {
+    for (auto& entry : entries) {
+      auto dir = entry.file.parent_path();
+      if (!root) {
+        root = dir;
+      }
+      while (root->has_relative_path() &&
+             dir.lexically_relative(*root).native().substr(0, 2) == "..") {
+        root = root->parent_path();
+      }
+    }
+  }
+
+  fs::create_directories(out_dir);
+  fs::current_path(out_dir);
+  source::SourceLoader::enable_cache();
+  meta_classes::MetaPool::enable();
+
+  std::vector<std::vector<std::vector<std::string>>> first_stages;
+  std::vector<std::vector<std::vector<std::string>>> third_stages;
+  std::size_t index = 0;
+  for (auto& [include_dirs, entries] : groups) {
+    for (auto& entry : entries) {
+      auto includes = "out/includes" + std::to_string(++index) + ".txt";
+      std::vector<std::string> stage_one = {"main", "1", entry.file.string(),
+                                            includes};
+      stage_one.insert(stage_one.end(), include_dirs.begin(),
+                       include_dirs.end());
+      std::vector<std::string> stage_two = {"main", "2", entry.file.string(),
+                                            includes,
+                                            (out_dir / "meta_out").string()};
+      first_stages.push_back({std::move(stage_one), std::move(stage_two)});
+
+      std::vector<std::string> stage_three = {
+          "main",
+          "3",
+          entry.file.string(),
+          (out_dir / entry.file.lexically_relative(*root)).string(),
+          includes,
+          meta_exe,
+          (out_dir / "meta_cache").string()};
+      stage_three.insert(stage_three.end(), flags.begin(), flags.end());
+      third_stages.push_back({std::move(stage_three)});
+    }
+  }
+
+  std::cout << "processing " << index << " sources in " << groups.size()
+            << " groups on " << threads << " threads" << std::endl;
+  auto failed = run_parallel(first_stages, threads);
+  if (failed == 0 && !meta_exe.empty()) {
+    failed = run_parallel(third_stages, threads);
+  }
+  meta_classes::MetaPool::clear();
+
+  if (failed > 0) {
+    std::cout << failed << " sources failed" << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+#ifdef ZERO_PREPROCESSOR_SERVER
+/**
+ * Stay resident and run the stages sent by the clients, the X3 symbol
+ * tables, the loaded sources and the meta processes with their expansions
+ * stay warm between the runs
+ *
+ * Once main is rebuilt the server runs the new build in its place
+ */
+int run_server(int argc, char* argv[]) {
+  std::string socket_path =
+      argc > 2 ? std::string{argv[2]} : server::default_socket_path();
+#ifdef __linux__
+  std::string exe = fs::read_symlink("/proc/self/exe").string();
+#else
+  std::string exe = fs::absolute(argv[0]).string();
+#endif
+  source::SourceLoader::enable_cache();
+  std_parser::incremental::enable_reuse();
+  meta_classes::MetaPool::enable();
+
+  // NOTE: the stages write their output to std::cout and std::cerr
+  server::ThreadOutput out_redirect{std::cout};
+  server::ThreadOutput err_redirect{std::cerr};
+  auto handler = [&](std::vector<std::string>& args, std::ostream& out,
+                     std::ostream& err) {
+    std::vector<char*> argv;
+    for (auto& arg : args) {
+      argv.push_back(arg.data());
+    }
+
+    out_redirect.redirect(out.rdbuf());
+    err_redirect.redirect(err.rdbuf());
+    int code = 1;
+    try {
+      code = run(static_cast<int>(argv.size()), argv.data());
+    } catch (std::exception const& e) {
+      std::cerr << e.what() << std::endl;
+    } catch (...) {
+      std::cerr << "unknown error" << std::endl;
+    }
+    out_redirect.redirect(nullptr);
+    err_redirect.redirect(nullptr);
+    return code;
+  };
+
+  std::cout << "serving on " << socket_path << std::endl;
+  int code = server::serve(socket_path, exe, handler);
+  meta_classes::MetaPool::clear();
+  if (code == server::restart) {
+    std::cout << exe << " was rebuilt, restarting" << std::endl;
+    execv(exe.c_str(), argv);
+    std::perror(exe.c_str());
+    return 1;
+  }
+  return code;
+}
+#endif
+
+#ifdef __linux__
+/**
+ * The stages of one source of a target as given by preprocess(), run in
+ * the build directory of the target
+ */
+struct WatchJob {
+  fs::path dir;
+  std::string source;
+  std::vector<std::vector<std::string>> stages;
+  // the normalized paths of the source and the headers it includes
+  std::unordered_set<std::string> dependencies;
+};
+
+/**
+ * Read the jobs of the .preprocess files written by preprocess() in the
+ * directories, one argument of main per line and a blank line after each
+ * stage
+ */
+std::vector<WatchJob> read_watch_jobs(std::vector<fs::path> const& dirs) {
+  std::map<std::pair<fs::path, std::string>, WatchJob> jobs;
+  for (auto& dir : dirs) {
+    for (auto& entry : fs::recursive_directory_iterator(dir)) {
+      if (entry.path().extension() != ".preprocess") {
+        continue;
+      }
+
+      std::ifstream in_file(entry.path());
+      while (in_file) {
+        std::vector<std::string> args = {"main"};
+        for (std::string arg; std::getline(in_file, arg) && !arg.empty();) {
+          args.push_back(std::move(arg));
+        }
+        if (args.size() < 3) {
+          continue;
+        }
+
+        auto job_dir = entry.path().parent_path();
+        auto& job = jobs[{job_dir, args[2]}];
+        job.dir = job_dir;
+        job.source = args[2];
+        job.stages.push_back(std::move(args));
+      }
+    }
+  }
+
+  std::vector<WatchJob> all_jobs;
+  for (auto& [key, job] : jobs) {
+    all_jobs.push_back(std::move(job));
+  }
+  return all_jobs;
+}
+
+/**
+ * Run the stages of the job in its directory, false if one of them failed
+ */
+bool run_watch_job(WatchJob& job) {
+  auto cwd = fs::current_path();
+  fs::current_path(job.dir);
+  bool ok = run_stages(job.stages);
+  fs::current_path(cwd);
+  return ok;
+}
+
+/**
+ * The source and the headers listed by stage one in its includes file
+ */
+void read_watch_dependencies(WatchJob& job) {
+  job.dependencies = {watch::normalize(job.dir / job.source)};
+  auto& stage = job.stages.front();
+  if (stage.size() < 4) {
+    return;
+  }
+
+  std::ifstream in_file(job.dir / stage[3]);
+  std::string include, out;
+  while (std::getline(in_file, include) && std::getline(in_file, out)) {
+    job.dependencies.insert(watch::normalize(job.dir / include));
+  }
+}
+
+/**
+ * Keep the include graph, the loaded sources and the meta processes in
+ * memory and run the stages of every source of the targets in the build
+ * directories again whenever the source or one of its headers changes
+ *
+ * NOTE: changed meta class definitions are only used once the meta
+ * executable is rebuilt, the meta processes are restarted then
+ */
+int run_watch(int argc, char* argv[]) {
+  std::vector<fs::path> dirs(argv + 2, argv + argc);
+  if (dirs.empty()) {
+    dirs.emplace_back(".");
+  }
+
+  watch::Watcher watcher;
+  if (!watcher.ok()) {
+    std::cout << "inotify is not available" << std::endl;
+    return 1;
+  }
+  source::SourceLoader::enable_cache();
+  std_parser::incremental::enable_reuse();
+  meta_classes::MetaPool::enable();
+
+  auto jobs = read_watch_jobs(dirs);
+  if (jobs.empty()) {
+    std::cout << "no .preprocess files found, run the build first"
+              << std::endl;
+    return 1;
+  }
+
+  auto watch_job = [&watcher](WatchJob& job) {
+    read_watch_dependencies(job);
+    for (auto& dependency : job.dependencies) {
+      if (!watcher.add(dependency)) {
+        std::cout << "can't watch " << dependency << std::endl;
+      }
+    }
+  };
+  for (auto& job : jobs) {
+    watch_job(job);
+  }
+  std::cout << "watching " << jobs.size() << " sources" << std::endl;
+
+  while (true) {
+    auto changed = watcher.wait(std::chrono::milliseconds(10));
+    for (auto& job : jobs) {
+      bool affected = std::any_of(
+          changed.begin(), changed.end(),
+          [&job](auto& path) { return job.dependencies.count(path) > 0; });
+      if (!affected) {
+        continue;
+      }
+
+      auto start = std::chrono::steady_clock::now();
+      bool ok = run_watch_job(job);
+      std::chrono::duration<double, std::milli> time =
+          std::chrono::steady_clock::now() - start;
+      std::cout << (ok ? "regenerated " : "failed ") << job.source << " in "
+                << time.count() << " ms" << std::endl;
+
+      // NOTE: stage one may have found new includes
+      watch_job(job);
+    }
+  }
+
+  return 0;
+}
+#endif
+
+int main(int argc, char* argv[]) {
+  if (argc > 1 && std::string_view{argv[1]} == "--compile-commands") {
+    return run_compile_commands(argc, argv);
+  }
+#ifdef __linux__
+  if (argc > 1 && std::string_view{argv[1]} == "--watch") {
+    return run_watch(argc, argv);
+  }
+#endif
+#ifdef ZERO_PREPROCESSOR_SERVER
+  if (argc > 1 && std::string_view{argv[1]} == "server") {
+    return run_server(argc, argv);
+  }
+#endif
+
+  // NOTE: the errors of the parsers and of the meta process are thrown so
+  // the meta processes are stopped on the way out
+  try {
+    return run(argc, argv);
+  } catch (std::exception const& e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+}
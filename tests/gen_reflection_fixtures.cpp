@@ -0,0 +1,71 @@
+// Generates the classes and the enum, with their reflection, serializers,
+// soa_vector accessors and comparisons, used by test_reflection.cpp
+//
+// usage: gen_reflection_fixtures out_header
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gen_bench.hpp>
+
+using namespace gen_bench;
+
+int main(int argc, char* argv[]) {
+  if (argc != 2) {
+    std::cout << "usage: " << argv[0] << " out_header\n";
+    return 1;
+  }
+
+  NoParent parent;
+  Parser parser{parent, Parser::Representation::Flat, true, true, true};
+
+  std::string out;
+  out += "#include <cstdint>\n#include <map>\n#include <string>\n";
+  out += "#include <unordered_map>\n#include <vector>\n\n";
+  out += parser.get_prepend();
+  out += '\n';
+  out += gen_struct(parser, "Fill",
+                    {{"std::uint64_t", "id"},
+                     {"double", "price"},
+                     {"std::vector<std::string>", "tags"}});
+  out += gen_struct(parser, "Order",
+                    {{"std::uint64_t", "id"},
+                     {"std::string", "symbol"},
+                     {"std::vector<Fill>", "fills"},
+                     {"std::vector<double>", "prices"},
+                     {"std::int32_t", "side"}});
+  out += gen_struct(parser, "Particle",
+                    {{"double", "x"}, {"double", "y"}, {"float", "mass"}});
+  out += gen_struct(parser, "Padded",
+                    {{"char", "tag"}, {"std::uint64_t", "value"}});
+  out += gen_struct(parser, "Switches", {{"std::vector<bool>", "states"}});
+
+  // NOTE: a map has no serializer, the header compiles as long as it isn't
+  // serialized
+  Parser serializers{parent, Parser::Representation::Flat, true, false, false};
+  out += gen_struct(serializers, "Indexed",
+                    {{"int", "id"}, {"std::map<int,int>", "index"}});
+
+  // NOTE: an unordered_map has no ordering and no hash, only equal and the
+  // equality operators are left
+  out += gen_struct(parser, "Lookup",
+                    {{"int", "id"}, {"std::unordered_map<int,int>", "index"}});
+  out += gen_struct(parser, "Lookups", {{"std::vector<Lookup>", "lookups"}});
+
+  ast::enum_ e;
+  e.type = ast::EnumType::ENUM_CLASS;
+  e.name = "Color";
+  e.as = {"int"};
+  ast::Enumeration color{std::move(e)};
+  // NOTE: the reflection closes the enum
+  out += "enum class Color : int {\nred,\ngreen,\nblue,\n";
+  color.set_enumerators({"red", "green", "blue"});
+  out += parser.generate_reflection(color);
+  out += '\n';
+
+  std::ofstream{argv[1]} << out;
+  return 0;
+}
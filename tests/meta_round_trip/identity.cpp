@@ -0,0 +1,19 @@
+// The meta classes of the meta process round trip test, linked with
+// meta_main.cpp into the test meta executable
+
+#include <meta.hpp>
+
+inline void identity(meta::type target, const meta::type) {
+  // NOTE: a body so the meta process asks for it to be parsed
+  target << "int generated = 1;";
+}
+
+// composed of identity, sees the members identity generated
+inline void counted(meta::type target, const meta::type source) {
+  identity(target, source);
+  target << "int members = " << static_cast<int>(target.variables().size())
+         << ";";
+}
+
+static const bool meta_functions_registered =
+    meta::register_functions({{"identity", &identity}, {"counted", &counted}});
@@ -0,0 +1,321 @@
+// Performance regression check of the StdParser and the meta class parser
+// on the fixed benchmark corpus, the measured metrics are compared with the
+// baseline and the check fails when one is worse than the tolerance allows
+//
+// usage: perf_regression std_parser|meta_classes baseline.json work_dir
+//                        [--tolerance=0.05] [--update] [--meta=meta_exe]
+//        perf_regression --meta-sources work_dir
+//
+// the compared metrics are the allocations, the allocated bytes and, where
+// perf_event_open is available, the retired user space instructions, the
+// wall time is only reported since it is not stable on CI machines
+//
+// meta_classes expands the meta classes of the corpus with the meta
+// executable built from the sources written by --meta-sources
+//
+// without a baseline of the benchmark it exits with 77, which ctest reports
+// as skipped, so a missing baseline is never mistaken for a passing check
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include <corpus.hpp>
+#include <meta_classes.hpp>
+#include <preprocessor.hpp>
+#include <source_loader.hpp>
+#include <std_parser.hpp>
+
+namespace {
+std::atomic<std::size_t> allocations{0};
+std::atomic<std::size_t> allocated_bytes{0};
+}  // namespace
+
+void* operator new(std::size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+  if (void* p = std::malloc(size == 0 ? 1 : size)) {
+    return p;
+  }
+  throw std::bad_alloc{};
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+/**
+ * Counter of the user space instructions of this process and its threads,
+ * empty when perf_event_open is not available or not permitted
+ */
+class InstructionCounter {
+  int fd = -1;
+
+ public:
+  InstructionCounter() {
+#ifdef __linux__
+    perf_event_attr attr{};
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.inherit = 1;
+    fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+  }
+
+  InstructionCounter(InstructionCounter const&) = delete;
+  InstructionCounter& operator=(InstructionCounter const&) = delete;
+
+  ~InstructionCounter() {
+#ifdef __linux__
+    if (fd >= 0) {
+      close(fd);
+    }
+#endif
+  }
+
+  void start() {
+#ifdef __linux__
+    if (fd >= 0) {
+      ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+  }
+
+  std::optional<std::size_t> stop() {
+#ifdef __linux__
+    if (fd >= 0) {
+      ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+      long long count = 0;
+      if (read(fd, &count, sizeof(count)) == sizeof(count)) {
+        return static_cast<std::size_t>(count);
+      }
+    }
+#endif
+    return std::nullopt;
+  }
+};
+
+constexpr int skipped = 77;
+
+/**
+ * The fixed corpus, changing it invalidates the baseline
+ */
+std::vector<std::string> write_corpus(fs::path const& dir, bool meta_classes) {
+  std::vector<std::string> paths;
+  for (std::uint32_t i = 0; i < 4; ++i) {
+    corpus::Options options;
+    options.seed = i + 1;
+    options.meta_classes = meta_classes ? 4 : 0;
+    // NOTE: no includes so the meta executable builds from the meta output
+    // of the corpus alone
+    options.includes = meta_classes ? 0 : options.includes;
+    auto path = (dir / ("corpus" + std::to_string(i) + ".hpp")).string();
+    source::write_if_changed(path, corpus::Generator{options}.generate());
+    paths.push_back(std::move(path));
+  }
+  return paths;
+}
+
+void parse_std(std::vector<std::string> const& paths, fs::path const& dir) {
+  source::SourceLoader loader{{}, dir / "out"};
+  for (auto& path : paths) {
+    auto source = loader.load_source(path);
+    std_parser::StdParser parser;
+    while (!source.is_finished()) {
+      auto out = parser.parse(source);
+      if (!out) {
+        throw std::runtime_error("can't parse " + path);
+      }
+      source.advance(std::distance(source.begin(), out->processed_to));
+    }
+  }
+}
+
+/**
+ * Write the meta functions of the corpus as stage two does, every header of
+ * the corpus has the same ones so the meta source includes only the first
+ */
+void write_meta_sources(fs::path const& dir) {
+  auto paths = write_corpus(dir, true);
+  auto meta_source = (dir / "corpus_meta.cpp").string();
+  source::write_if_changed(meta_source, "#include \"corpus0.hpp\"\n");
+
+  source::SourceLoader loader{{}, dir / "out"};
+  auto meta_out = (dir / "meta_out").string();
+  auto meta_classes = [&](auto& parent) {
+    return meta_classes::MetaClassParser{parent, "", meta_out};
+  };
+  auto std_parser = [](auto&) { return std_parser::StdParser{}; };
+  Preprocessor preprocessor(std::move(loader), meta_classes, std_parser);
+  preprocessor.preprocess_source(paths.front());
+  preprocessor.preprocess_source(meta_source);
+}
+
+void parse_meta_classes(std::vector<std::string> const& paths,
+                        fs::path const& dir, std::string const& meta_exe) {
+  source::SourceLoader loader{{}, dir / "out"};
+  auto meta_classes = [&](auto& parent) {
+    return meta_classes::MetaClassParser{parent, meta_exe, ""};
+  };
+  auto std_parser = [](auto&) { return std_parser::StdParser{}; };
+  Preprocessor preprocessor(std::move(loader), meta_classes, std_parser);
+  std::string out;
+  auto writer = [&out](auto& src) { out.append(src.begin(), src.end()); };
+  for (auto& path : paths) {
+    out.clear();
+    preprocessor.process_source(path, writer);
+  }
+}
+
+int main(int argc, char* argv[]) {
+  if (argc == 3 && std::string_view{argv[1]} == "--meta-sources") {
+    write_meta_sources(fs::path{argv[2]} / "meta_classes");
+    return 0;
+  }
+
+  if (argc < 4) {
+    std::cout << "usage: " << argv[0]
+              << " std_parser|meta_classes baseline.json work_dir"
+                 " [--tolerance=0.05] [--update] [--meta=meta_exe]\n"
+              << "       " << argv[0] << " --meta-sources work_dir\n";
+    return 1;
+  }
+
+  std::string benchmark = argv[1];
+  std::string baseline_path = argv[2];
+  fs::path dir = fs::path{argv[3]} / benchmark;
+  double tolerance = 0.05;
+  bool update = false;
+  std::string meta_exe;
+  for (int i = 4; i < argc; ++i) {
+    std::string_view flag = argv[i];
+    std::string_view tolerance_flag = "--tolerance=";
+    std::string_view meta_flag = "--meta=";
+    if (flag == "--update") {
+      update = true;
+    } else if (flag.substr(0, tolerance_flag.size()) == tolerance_flag) {
+      flag.remove_prefix(tolerance_flag.size());
+      tolerance = std::atof(std::string{flag}.c_str());
+    } else if (flag.substr(0, meta_flag.size()) == meta_flag) {
+      flag.remove_prefix(meta_flag.size());
+      meta_exe = flag;
+    } else {
+      std::cout << "unknown flag " << flag << std::endl;
+      return 1;
+    }
+  }
+
+  if (benchmark != "std_parser" && benchmark != "meta_classes") {
+    std::cout << "unknown benchmark " << benchmark << std::endl;
+    return 1;
+  }
+
+  if (benchmark == "meta_classes" && meta_exe.empty()) {
+    std::cout << "meta_classes needs the meta executable, give it with --meta"
+              << std::endl;
+    return 1;
+  }
+
+  auto paths = write_corpus(dir, benchmark == "meta_classes");
+  auto run = [&] {
+    if (benchmark == "std_parser") {
+      parse_std(paths, dir);
+    } else {
+      parse_meta_classes(paths, dir, meta_exe);
+    }
+  };
+
+  // NOTE: one warm up run so the lazily initialized statics are not counted
+  run();
+
+  InstructionCounter counter;
+  std::size_t allocations_before = allocations;
+  std::size_t bytes_before = allocated_bytes;
+  auto start = std::chrono::steady_clock::now();
+  counter.start();
+  run();
+  auto instructions = counter.stop();
+  std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+
+  std::map<std::string, std::size_t> metrics = {
+      {"allocations", allocations - allocations_before},
+      {"allocated_bytes", allocated_bytes - bytes_before}};
+  if (instructions) {
+    metrics.emplace("instructions", *instructions);
+  } else {
+    std::cout << "perf_event_open is not available, instructions not compared\n";
+  }
+  std::cout << benchmark << ": " << time.count() * 1000 << " ms\n";
+
+  namespace pt = boost::property_tree;
+  pt::ptree baseline;
+  if (fs::exists(baseline_path)) {
+    pt::read_json(baseline_path, baseline);
+  }
+
+  if (update) {
+    pt::ptree entry;
+    for (auto& [name, value] : metrics) {
+      entry.put(name, value);
+    }
+    baseline.put_child(benchmark, entry);
+    pt::write_json(baseline_path, baseline);
+    std::cout << "updated the baseline of " << benchmark << '\n';
+    return 0;
+  }
+
+  bool failed = false;
+  std::size_t compared = 0;
+  for (auto& [name, value] : metrics) {
+    auto expected = baseline.get_optional<std::size_t>(benchmark + "." + name);
+    std::cout << name << ": " << value;
+    if (!expected) {
+      std::cout << " (no baseline, record it with --update)\n";
+      continue;
+    }
+
+    ++compared;
+
+    double ratio = *expected ? static_cast<double>(value) / *expected : 1;
+    std::cout << ", baseline " << *expected << " (" << (ratio - 1) * 100
+              << "%)";
+    if (ratio > 1 + tolerance) {
+      std::cout << " REGRESSION";
+      failed = true;
+    } else if (ratio < 1 - tolerance) {
+      std::cout << " improved, update the baseline";
+    }
+    std::cout << '\n';
+  }
+
+  if (compared == 0) {
+    std::cout << "SKIPPED: no baseline of " << benchmark << " in "
+              << baseline_path << '\n';
+    return skipped;
+  }
+
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,45 @@
+#include <string>
+
+#include <incremental_parser.hpp>
+
+#include <catch2/catch.hpp>
+
+using namespace std_parser;
+using namespace std_parser::incremental;
+
+namespace {
+std::string const source = R"(#include <a.hpp>
+namespace nsp {
+struct Foo {
+  int a;
+  int get() { return a; }
+};
+
+int add(int a, int b) { return a + b; }
+
+int sub(int a, int b) { return a - b; }
+}  // namespace nsp
+)";
+}  // namespace
+
+TEST_CASE("Split into top level chunks", "[incremental_parser]") {
+  auto chunks = split(source);
+  REQUIRE(chunks);
+  REQUIRE(chunks->size() == 7);
+  REQUIRE((*chunks)[1].kind == ChunkKind::NamespaceBegin);
+  REQUIRE((*chunks)[5].kind == ChunkKind::NamespaceEnd);
+  REQUIRE(chunks->front().begin == 0);
+  REQUIRE(chunks->back().end == source.size());
+
+  REQUIRE_FALSE(split("namespace nsp { int a;"));
+  REQUIRE_FALSE(split("int f() {}}"));
+}
+
+TEST_CASE("Local types are matched as whole words", "[incremental_parser]") {
+  REQUIRE(has_local_types("struct Foo { int a; };"));
+  REQUIRE(has_local_types("void f() { enum E { a }; }"));
+  REQUIRE(has_local_types("int f() {\nclass\nA {}; return 0; }"));
+  REQUIRE_FALSE(has_local_types("int classify(int a) { return a; }"));
+  REQUIRE_FALSE(has_local_types("int f() { return my_struct + enums; }"));
+  REQUIRE_FALSE(has_local_types("void reunion(); void unionize();"));
+}
@@ -0,0 +1,76 @@
+#include <string>
+
+#include <jobserver.hpp>
+
+#include <catch2/catch.hpp>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/stat.h>
+
+using namespace jobserver;
+
+TEST_CASE("Tokens are not limited without a jobserver", "[jobserver]") {
+  Client client{"-j --no-print-directory"};
+  REQUIRE(!client.ok());
+
+  auto first = client.try_acquire();
+  auto second = client.try_acquire();
+  REQUIRE(first);
+  REQUIRE(second);
+}
+
+TEST_CASE("Tokens are read from the jobserver pipe", "[jobserver]") {
+  int fds[2];
+  REQUIRE(pipe(fds) == 0);
+  REQUIRE(write(fds[1], "+", 1) == 1);
+
+  // the last option is the one of the closest make
+  Client client{"-j2 --jobserver-auth=100,101 --jobserver-auth=" +
+                std::to_string(fds[0]) + "," + std::to_string(fds[1])};
+  REQUIRE(client.ok());
+
+  // NOTE: the implicit token is the one of the running thread, only the
+  // tokens of the pipe are handed out
+  {
+    auto from_pipe = client.try_acquire();
+    REQUIRE(from_pipe);
+    REQUIRE(!client.try_acquire());
+  }
+
+  // the byte is written back to the pipe
+  auto from_pipe = client.try_acquire();
+  REQUIRE(from_pipe);
+  REQUIRE(!client.try_acquire());
+
+  close(fds[0]);
+  close(fds[1]);
+}
+
+TEST_CASE("Tokens are read from the jobserver fifo", "[jobserver]") {
+  std::string path = "test_jobserver_fifo";
+  unlink(path.c_str());
+  REQUIRE(mkfifo(path.c_str(), 0600) == 0);
+  int fd = open(path.c_str(), O_RDWR);
+  REQUIRE(write(fd, "++", 2) == 2);
+
+  {
+    Client client{" -j3 --jobserver-auth=fifo:" + path};
+    REQUIRE(client.ok());
+    auto first = client.acquire();
+    auto second = client.acquire();
+    REQUIRE(!client.try_acquire());
+  }
+
+  char tokens[2];
+  REQUIRE(read(fd, tokens, 2) == 2);
+  REQUIRE(std::string(tokens, 2) == "++");
+
+  close(fd);
+  unlink(path.c_str());
+}
+
+TEST_CASE("Stale jobserver descriptors are ignored", "[jobserver]") {
+  Client client{"--jobserver-auth=1000,1001"};
+  REQUIRE(!client.ok());
+}
+#endif
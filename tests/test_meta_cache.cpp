@@ -0,0 +1,83 @@
+#include <filesystem>
+#include <string>
+#include <thread>
+
+#include <meta_cache.hpp>
+
+#include <catch2/catch.hpp>
+
+using namespace meta_classes;
+
+TEST_CASE("Meta cache keys are stable", "[meta_cache]") {
+  MetaCache cache;
+
+  auto key = cache.make_key("interface", "Foo\n0\n0\n");
+  REQUIRE(key == cache.make_key("interface", "Foo\n0\n0\n"));
+  REQUIRE(key != cache.make_key("value", "Foo\n0\n0\n"));
+  REQUIRE(key != cache.make_key("interface", "Bar\n0\n0\n"));
+  REQUIRE(key.size() == 32);
+}
+
+TEST_CASE("Meta cache hits after store", "[meta_cache]") {
+  MetaCache cache;
+
+  auto key = cache.make_key("interface", "Foo");
+  REQUIRE_FALSE(cache.find(key));
+
+  cache.store(key, "struct Foo {};");
+  auto out = cache.find(key);
+  REQUIRE(out);
+  REQUIRE(*out == "struct Foo {};");
+  REQUIRE(cache.get_hits() == 1);
+  REQUIRE(cache.get_misses() == 1);
+}
+
+TEST_CASE("Meta cache is reused from disk", "[meta_cache]") {
+  auto dir = fs::temp_directory_path() / "zero_preprocessor_meta_cache_test";
+  fs::remove_all(dir);
+
+  std::string key;
+  {
+    MetaCache cache{"", dir};
+    key = cache.make_key("interface", "Foo");
+    cache.store(key, "struct Foo {};");
+  }
+
+  MetaCache cache{"", dir};
+  auto out = cache.find(key);
+  REQUIRE(out);
+  REQUIRE(*out == "struct Foo {};");
+
+  fs::remove_all(dir);
+}
+
+TEST_CASE("Meta cache stores of the same key don't tear each other",
+          "[meta_cache]") {
+  auto dir = fs::temp_directory_path() / "zero_preprocessor_meta_cache_race";
+  fs::remove_all(dir);
+
+  std::string const a(1 << 16, 'a');
+  std::string const b(1 << 16, 'b');
+  std::string key;
+  {
+    MetaCache cache{"", dir};
+    key = cache.make_key("interface", "Foo");
+    std::thread writer{[&] {
+      MetaCache other{"", dir};
+      for (int i = 0; i < 50; ++i) {
+        other.store(key, a);
+      }
+    }};
+    for (int i = 0; i < 50; ++i) {
+      cache.store(key, b);
+    }
+    writer.join();
+  }
+
+  MetaCache cache{"", dir};
+  auto out = cache.find(key);
+  REQUIRE(out);
+  REQUIRE((*out == a || *out == b));
+
+  fs::remove_all(dir);
+}
@@ -0,0 +1,76 @@
+#include <set>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <std_parser.hpp>
+
+#include <gen_utils.hpp>
+#include <meta_process.hpp>
+
+#include <catch2/catch.hpp>
+
+using namespace meta_classes;
+
+namespace {
+/**
+ * Run a batch through the test meta executable over the transport
+ */
+void round_trip(MetaTransport transport) {
+  MetaProcess process{TEST_META_EXE, transport};
+  REQUIRE(process.ok());
+
+  process.output << 1 << std::endl;
+  int n = 0;
+  process.input >> n;
+  REQUIRE(n == 2);
+  std::set<std::string> names;
+  for (std::string name; n-- > 0 && process.input >> name;) {
+    names.insert(std::move(name));
+  }
+  REQUIRE(names == std::set<std::string>{"counted", "identity"});
+
+  std::vector<MetaClassRequest> requests;
+  for (auto [meta_class, cls_name] :
+       {std::pair{"identity", "First"}, std::pair{"identity", "Second"},
+        std::pair{"counted", "Third"}}) {
+    std_parser::rules::ast::class_or_struct cls;
+    cls.type = std_parser::rules::ast::class_type::STRUCT;
+    cls.name = cls_name;
+    requests.push_back({meta_class, std::move(cls)});
+  }
+
+  std_parser::StdParser std_parser;
+  std::vector<std::string> errors;
+  auto reporter = [&errors](std::string_view msg) { errors.emplace_back(msg); };
+  std::ostringstream log;
+  auto generated =
+      gen_meta_classes(process, requests, std_parser, reporter, log);
+
+  REQUIRE(errors.empty());
+  REQUIRE(log.str().find("3 metaclasses") != std::string::npos);
+  REQUIRE(generated.size() == 3);
+  REQUIRE(generated[0].get_class().name == "First");
+  REQUIRE(generated[1].get_class().name == "Second");
+  REQUIRE(generated[2].get_class().name == "Third");
+  for (auto& cls : generated) {
+    REQUIRE(cls.output.find("generated") != std::string::npos);
+  }
+  // the body identity generated was parsed before counted looked at it
+  REQUIRE(generated[2].output.find("members = 1") != std::string::npos);
+
+  process.output << 3 << std::endl;
+  process.wait();
+}
+}  // namespace
+
+TEST_CASE("Meta process round trip over pipes", "[meta_process]") {
+  round_trip(MetaTransport::Pipe);
+}
+
+#ifdef META_SHM_SUPPORTED
+TEST_CASE("Meta process round trip over shared memory", "[meta_process]") {
+  round_trip(MetaTransport::SharedMemory);
+}
+#endif
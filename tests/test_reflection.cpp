@@ -0,0 +1,219 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <reflection_fixtures.hpp>
+#include <soa_vector.hpp>
+
+#include <catch2/catch.hpp>
+
+namespace {
+Order make_order() {
+  Order order{};
+  order.id = 42;
+  order.symbol = "SYM";
+  order.fills = {{1, 10.5, {"a", "bc"}}, {2, 11.25, {}}};
+  order.prices = {1.5, 2.5, 3.5};
+  order.side = -1;
+  return order;
+}
+}  // namespace
+
+TEST_CASE("Serializers round trip every member", "[reflection]") {
+  auto order = make_order();
+  std::string buffer;
+  reflect::serial::serialize(buffer, order);
+
+  Order decoded{};
+  REQUIRE(reflect::serial::deserialize(buffer, decoded));
+  REQUIRE(decoded == order);
+  REQUIRE(decoded.fills[0].tags == std::vector<std::string>{"a", "bc"});
+
+  // empty strings and vectors
+  Order empty{};
+  buffer.clear();
+  reflect::serial::serialize(buffer, empty);
+  decoded = make_order();
+  REQUIRE(reflect::serial::deserialize(buffer, decoded));
+  REQUIRE(decoded == empty);
+}
+
+TEST_CASE("Serializers fail on a truncated buffer", "[reflection]") {
+  std::string buffer;
+  reflect::serial::serialize(buffer, make_order());
+
+  for (std::size_t size = 0; size < buffer.size(); ++size) {
+    Order decoded{};
+    INFO("size " << size);
+    REQUIRE_FALSE(reflect::serial::deserialize(
+        std::string_view{buffer}.substr(0, size), decoded));
+  }
+}
+
+TEST_CASE("Serializers skip the padding and never write pointers",
+          "[reflection]") {
+  static_assert(!reflect::serial::helper::is_bulk_v<int*>);
+  static_assert(!reflect::serial::helper::is_bulk_v<Padded>);
+  static_assert(reflect::serial::helper::is_bulk_v<double>);
+
+  // the padding of the two differs
+  alignas(Padded) unsigned char storage_a[sizeof(Padded)];
+  alignas(Padded) unsigned char storage_b[sizeof(Padded)];
+  std::memset(storage_a, 0x00, sizeof(storage_a));
+  std::memset(storage_b, 0xff, sizeof(storage_b));
+  auto& a = *new (storage_a) Padded{'x', 7};
+  auto& b = *new (storage_b) Padded{'x', 7};
+
+  std::string buffer_a, buffer_b;
+  reflect::serial::serialize(buffer_a, a);
+  reflect::serial::serialize(buffer_b, b);
+  REQUIRE(buffer_a == buffer_b);
+  REQUIRE(buffer_a.size() == 1 + 8);
+
+  Padded decoded{};
+  REQUIRE(reflect::serial::deserialize(buffer_a, decoded));
+  REQUIRE(decoded == a);
+
+  Switches switches{{true, false, true}};
+  std::string buffer;
+  reflect::serial::serialize(buffer, switches);
+  Switches decoded_switches{};
+  REQUIRE(reflect::serial::deserialize(buffer, decoded_switches));
+  REQUIRE(decoded_switches == switches);
+
+  // NOTE: only the members that can be serialized are
+  Indexed indexed{1, {{2, 3}}};
+  REQUIRE(indexed.id == 1);
+}
+
+TEST_CASE("Enums convert to and from strings", "[reflection]") {
+  REQUIRE(reflect::enum_to_string(Color::green) == "green");
+  REQUIRE(reflect::enum_from_string<Color>("blue") == Color::blue);
+  REQUIRE_FALSE(reflect::enum_from_string<Color>("purple"));
+  REQUIRE_FALSE(reflect::enum_from_string<Color>(""));
+  REQUIRE_FALSE(reflect::enum_from_string<Color>("re"));
+}
+
+namespace {
+enum class Wide : std::int64_t { lowest = INT64_MIN, zero = 0, highest = INT64_MAX };
+}  // namespace
+
+template <>
+struct reflect::Reflect<Wide> {
+  constexpr inline static std::array<const char*, 3> enumerator_names{
+      {"lowest", "zero", "highest"}};
+  constexpr inline static std::array<Wide, 3> enumerator_constants{
+      {Wide::lowest, Wide::zero, Wide::highest}};
+};
+
+TEST_CASE("Enums spanning all of the 64 bits convert", "[reflection]") {
+  REQUIRE(reflect::enum_to_string(Wide::lowest) == "lowest");
+  REQUIRE(reflect::enum_to_string(Wide::highest) == "highest");
+  REQUIRE(reflect::enum_to_string(static_cast<Wide>(1)).empty());
+  REQUIRE(reflect::enum_from_string<Wide>("highest") == Wide::highest);
+  REQUIRE_FALSE(reflect::enum_from_string<Wide>("high"));
+}
+
+TEST_CASE("Comparisons and hash are consistent", "[reflection]") {
+  auto a = make_order();
+  auto b = make_order();
+  REQUIRE(a == b);
+  REQUIRE_FALSE(a != b);
+  REQUIRE(reflect::cmp::compare(a, b) == 0);
+  REQUIRE(std::hash<Order>{}(a) == std::hash<Order>{}(b));
+  REQUIRE(reflect::cmp::hash<Order>{}(a) == std::hash<Order>{}(a));
+
+  // the members are compared in declaration order
+  b.fills[1].tags.push_back("z");
+  REQUIRE(a != b);
+  REQUIRE(a < b);
+  REQUIRE(b > a);
+  REQUIRE(a <= b);
+  REQUIRE(reflect::cmp::compare(a, b) < 0);
+  REQUIRE(reflect::cmp::compare(b, a) > 0);
+
+  b = make_order();
+  b.symbol = "ABC";
+  b.side = 5;
+  REQUIRE(b < a);
+  REQUIRE(reflect::cmp::compare(b, a) < 0);
+}
+
+TEST_CASE("Comparisons are only missing where the members lack them",
+          "[reflection]") {
+  using namespace reflect::cmp::helper;
+  static_assert(has_equal<Lookup>::value);
+  static_assert(!has_compare<Lookup>::value);
+  static_assert(!has_hash<Lookup>::value);
+  static_assert(!has_less_operator<Lookup>::value);
+  static_assert(!has_std_hash<Lookup>::value);
+  static_assert(has_equal<Lookups>::value);
+  static_assert(!has_compare<Lookups>::value);
+  static_assert(!has_std_hash<Lookups>::value);
+
+  Lookup a{1, {{2, 3}}};
+  Lookup b = a;
+  REQUIRE(a == b);
+  b.index[4] = 5;
+  REQUIRE(a != b);
+  REQUIRE(Lookups{{a}} != Lookups{{b}});
+}
+
+TEST_CASE("soa_vector stores the members in columns", "[reflection]") {
+  reflect::soa_vector<Particle> particles;
+  for (int i = 0; i < 10; ++i) {
+    particles.push_back({1.0 * i, 2.0 * i, 0.5f});
+  }
+  REQUIRE(particles.size() == 10);
+
+  REQUIRE(particles.x()[3] == 3.0);
+  REQUIRE(particles.column<&Particle::y>()[3] == 6.0);
+  REQUIRE(particles[4].mass() == 0.5f);
+
+  particles[4].x() = 40.0;
+  REQUIRE(particles.x()[4] == 40.0);
+  Particle p = particles[4];
+  REQUIRE(p == Particle{40.0, 8.0, 0.5f});
+
+  particles[5] = Particle{-1.0, -2.0, 3.0f};
+  REQUIRE(particles.y()[5] == -2.0);
+
+  double sum = 0;
+  for (auto particle : particles) {
+    sum += particle.get<&Particle::y>();
+  }
+  REQUIRE(sum == 2.0 * 45 - 10.0 - 2.0);
+}
+
+TEST_CASE("soa_vector works with the standard algorithms", "[reflection]") {
+  reflect::soa_vector<Particle> particles;
+  for (int i = 0; i < 100; ++i) {
+    particles.push_back({(i * 37) % 100 * 1.0, -1.0 * i, 1.0f * i});
+  }
+
+  auto begin = particles.begin();
+  REQUIRE(2 + begin == begin + 2);
+  REQUIRE(particles.end() > begin);
+  REQUIRE(begin <= begin);
+  REQUIRE(particles.end() >= begin + 1);
+
+  swap(particles[0], particles[1]);
+  REQUIRE(particles.y()[0] == -1.0);
+  REQUIRE(particles.mass()[1] == 0.0f);
+
+  std::sort(particles.begin(), particles.end(),
+            [](Particle const& a, Particle const& b) { return a.x < b.x; });
+  for (int i = 0; i < 100; ++i) {
+    REQUIRE(particles.x()[i] == i);
+    // the members move together with their element
+    REQUIRE(particles.mass()[i] == -particles.y()[i]);
+  }
+
+  std::sort(particles.begin(), particles.end());
+  REQUIRE(std::is_sorted(particles.begin(), particles.end()));
+}
@@ -0,0 +1,95 @@
+#include <filesystem>
+#include <string>
+#include <utility>
+#include <variant>
+
+#include <incremental_parser.hpp>
+#include <preprocessor.hpp>
+#include <source_loader.hpp>
+
+#include <catch2/catch.hpp>
+
+using namespace std_parser;
+using namespace std_parser::incremental;
+
+namespace {
+std::string const code = R"(
+namespace nsp {
+struct Foo {
+  int a;
+  int get() { return a; }
+};
+
+int add(int a, int b) { return a + b; }
+
+int sub(int a, int b) { return a - b; }
+}  // namespace nsp
+)";
+
+/**
+ * Run a stage on the content and return the number of reused chunks and the
+ * parsed sub function; the Preprocessor type is the same every time so the
+ * versions of the source are shared between the runs
+ */
+std::pair<std::size_t, rules::ast::Function> run_stage(
+    fs::path const& dir, std::string const& content) {
+  auto path = (dir / "reuse.hpp").string();
+  source::write_if_changed(path, content);
+
+  auto std_parser = [](auto& parent) { return ReusingStdParser{parent}; };
+  Preprocessor preprocessor(source::SourceLoader{{}, dir}, std_parser);
+  std::string out;
+  auto writer = [&out](auto& src) { out.append(src.begin(), src.end()); };
+  preprocessor.process_source(path, writer);
+  REQUIRE(out == content);
+
+  auto& parser =
+      preprocessor.get_parser<decltype(preprocessor)::std_parser_id>();
+  auto& top = std::get<rules::ast::Namespace>(
+      parser.get_all_code_fragments().front());
+  auto& nsp =
+      std::get<rules::ast::Namespace>(top.get_all_code_fragments().back());
+  return {parser.get_reused_chunks(), *nsp.find_function("sub")};
+}
+}  // namespace
+
+TEST_CASE("The unchanged functions of the previous version are reused",
+          "[incremental_parser]") {
+  auto dir = fs::temp_directory_path() / "reusing_std_parser";
+  fs::create_directories(dir);
+  enable_reuse();
+
+  REQUIRE(run_stage(dir, code).first == 0);
+  REQUIRE(run_stage(dir, code).first == 2);
+
+  auto edited = code;
+  edited.replace(edited.find("a - b"), 5, "b - a");
+  auto [reused, sub] = run_stage(dir, edited);
+  REQUIRE(reused == 1);
+  REQUIRE(sub.body.find("b - a") != std::string::npos);
+}
+
+TEST_CASE("Reused functions are moved with their lines",
+          "[incremental_parser]") {
+  auto dir = fs::temp_directory_path() / "reusing_std_parser_rows";
+  fs::create_directories(dir);
+  enable_reuse();
+
+  auto row = run_stage(dir, code).second.loc.row;
+  auto [reused, sub] = run_stage(dir, "// a new line\n" + code);
+  REQUIRE(reused == 2);
+  REQUIRE(sub.loc.row == row + 1);
+}
+
+TEST_CASE("Functions named like a type keyword are reused",
+          "[incremental_parser]") {
+  auto dir = fs::temp_directory_path() / "reusing_std_parser_keywords";
+  fs::create_directories(dir);
+  enable_reuse();
+
+  auto with_classify = code;
+  with_classify.insert(with_classify.find("int sub"),
+                       "int classify(int a) { return a; }\n\n");
+  REQUIRE(run_stage(dir, with_classify).first == 0);
+  REQUIRE(run_stage(dir, with_classify).first == 3);
+}
@@ -0,0 +1,58 @@
+#include <string>
+#include <thread>
+
+#include <meta_include/shm_ring.hpp>
+
+#include <catch2/catch.hpp>
+
+#ifdef META_SHM_SUPPORTED
+using namespace meta_shm;
+
+TEST_CASE("Shared ring passes formatted content", "[shm_ring]") {
+  auto channel = SharedChannel::create();
+  REQUIRE(channel);
+
+  RingWriter writer_buf{channel->to_meta};
+  RingReader reader_buf{channel->to_meta};
+  std::ostream writer{&writer_buf};
+  std::istream reader{&reader_buf};
+
+  writer << 4 << '\n' << "interface" << '\n' << 42 << std::endl;
+
+  int mode, value;
+  std::string name;
+  reader >> mode >> name >> value;
+  REQUIRE(mode == 4);
+  REQUIRE(name == "interface");
+  REQUIRE(value == 42);
+}
+
+TEST_CASE("Shared ring wraps around", "[shm_ring]") {
+  auto channel = SharedChannel::create();
+  REQUIRE(channel);
+
+  // more than the capacity so the writer has to wait for the reader
+  constexpr std::size_t lines = 3 * ring_capacity / 8;
+  std::thread producer{[&channel] {
+    RingWriter writer_buf{channel->to_host};
+    std::ostream writer{&writer_buf};
+    for (std::size_t i = 0; i < lines; ++i) {
+      writer << i % 10000000 << '\n';
+    }
+    writer.flush();
+  }};
+
+  RingReader reader_buf{channel->to_host};
+  std::istream reader{&reader_buf};
+  bool in_order = true;
+  for (std::size_t i = 0; i < lines; ++i) {
+    std::size_t value;
+    reader >> value;
+    in_order &= value == i % 10000000;
+  }
+  producer.join();
+
+  REQUIRE(reader);
+  REQUIRE(in_order);
+}
+#endif